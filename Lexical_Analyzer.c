@@ -2,48 +2,136 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#ifdef LEXER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef LEXER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "Lexical_Analyzer.h"
+#ifndef _WIN32
+#include <unistd.h>
+#include <glob.h>
+#endif
 
 #define MAX_LINE 1000
-#define MAX_TOKENS_PER_LINE 200
+#define READ_BLOCK_SIZE (64 * 1024)  // Bytes read from an input stream at a time
+#define LEXER_OUT_OF_MEMORY "out of memory"
 
-// Symbol Table Struct
-typedef struct {
-    char name[100];    // Identifier name
-    char type[100];    // Data type (int, float, etc.)
-    char value[100];   // Value or "-" if uninitialized
-    int line;          // Line number declared
-} Symbol;
-
-Symbol symbolTable[1000];
-int symbolCount = 0;
+// Batch validator tuning
+#define BATCH_BLOCK_SIZE (8 * 1024 * 1024)  // Bytes of input validated per round
+#define BATCH_MAX_THREADS 64
+#define OVERSIZED_NAME_SHOWN 32  // Leading bytes echoed for a line longer than a block
 
-//Valid/Invalid Identifiers
-char validIdentifiers[1000][100];
-int validIdentifiersCount = 0;
-char invalidIdentifiers[1000][100];
-int invalidIdentifiersCount = 0;
+// Distinct strings in first-seen order. The strings live back to back in one
+// arena and a small open-addressing hash answers "seen before?" in O(1).
+// The index of a string in the list is its intern ID.
+typedef struct {
+    char *arena;        // NUL-terminated strings
+    size_t arenaLen;
+    size_t arenaCap;
+    size_t *offsets;    // Start of each entry in the arena
+    int count;
+    int cap;
+    int *buckets;       // Entry index + 1, 0 = empty
+    int bucketCap;      // Power of two
+} TokenList;
+
+// Intern IDs in first-seen order
+typedef struct {
+    unsigned *ids;
+    int count;
+    int cap;
+} IdList;
 
-//Other Tokens
-char othersFound[1000][100];
-int othersCount = 0;
+// Structure-of-arrays token stream of the whole input, one entry per token in
+// input order. Category passes walk the kinds and ids arrays instead of strings.
+typedef struct {
+    unsigned char *kinds;   // TokenCategory of each token
+    unsigned *ids;          // Intern ID
+    size_t *offsets;        // Byte offset into the input
+    unsigned *lengths;
+    size_t count;
+    size_t cap;
+} TokenBatch;
+
+// Token spans of one line. Capacity is reserved from the line length before
+// tokenizing (a line of n bytes has at most n tokens), so a line can never
+// overflow it.
+typedef struct {
+    int *starts;      // Position of each token in the line
+    int *lengths;
+    int count;
+    int cap;
+} LineTokens;
+
+// Per intern ID flags
+#define ID_VALID   0x01  // Listed as a valid identifier
+#define ID_INVALID 0x02  // Listed as an invalid identifier
+#define ID_SYMBOL  0x04  // Entered in the symbol table
+
+struct LexerContext {
+    Symbol *symbolTable;
+    int symbolCount;
+    int symbolCap;
+
+    // Every distinct token text is interned once; its category and flags are
+    // stored per ID, so classification runs once per distinct token
+    TokenList interned;
+    unsigned char *idKinds;
+    unsigned char *idFlags;
+    unsigned long long *idHashes;
+    int idCap;
+
+    IdList categories[CATEGORY_COUNT];
+
+    TokenBatch tokens;
+    bool statisticsOnly;   // Lines only update stats: no tokens, tables or line index
+    bool referenceTokenizer;  // True: lines go through tokenizeLine instead of tokenizeLineFast
+    TokenStats *stats;     // Optional, updated line by line
+
+    // Line index: byte offset where each line starts, lineStarts[0] == 0
+    size_t *lineStarts;
+    size_t lineStartCount;
+    size_t lineStartCap;
+
+    // Per-line scratch space; also holds a partial line between feedLexer calls
+    char *line;
+    size_t lineLen;
+    size_t lineCap;
+    LineTokens lineTokens;
+    const char **lineText;  // Interned text of the current line's tokens
+    int lineTextCap;
+
+    size_t inputOffset;  // Bytes fed so far
+    int lineno;
+    int insideComment;  // Multi-line comment handling
+    const char *error;  // First failure of the run (static string), NULL if none
+};
 
 // Keyword List
-const char *keywords[] = {
+static const char *keywords[] = {
     "int", "float", "char", "double", "return", "if", "else", "for", "while",
     "void", "do", "switch", "case", "default", "break", "continue", "struct",
     "typedef", "include", "define", "unsigned", "const", "static", "long", "short", "signed"
 };
-int keywordCount = sizeof(keywords) / sizeof(keywords[0]);
+static int keywordCount = sizeof(keywords) / sizeof(keywords[0]);
 
 //Multi-character Operators
-const char *multiCharOps[] = {
+static const char *multiCharOps[] = {
     "++", "--", "==", "!=", "<=", ">=", "&&", "||", "+=", "-=", "*=", "/="
 };
 
 // Utility Functions
 
-int isKeyword(const char *word) {
+static int isKeyword(const char *word) {
     for (int i = 0; i < keywordCount; i++) {
         if (strcmp(word, keywords[i]) == 0)
             return 1;
@@ -51,7 +139,7 @@ int isKeyword(const char *word) {
     return 0;
 }
 
-int isMultiCharOp(const char *word) {
+static int isMultiCharOp(const char *word) {
     for (int i = 0; i < sizeof(multiCharOps) / sizeof(multiCharOps[0]); i++) {
         if (strcmp(word, multiCharOps[i]) == 0)
             return 1;
@@ -59,30 +147,30 @@ int isMultiCharOp(const char *word) {
     return 0;
 }
 
-int isOperatorChar(char ch) {
+static int isOperatorChar(char ch) {
     return strchr("+-*/%=<>!&|^~", ch) != NULL;
 }
 
-int isOperatorString(const char *str) {
+static int isOperatorString(const char *str) {
     if (strlen(str) == 1 && isOperatorChar(str[0])) return 1;
     if (isMultiCharOp(str)) return 1;
     return 0;
 }
 
-int isBracket(char ch) {
+static int isBracket(char ch) {
     return strchr("(){}[]", ch) != NULL;
 }
 
-int isSeparator(char ch) {
+static int isSeparator(char ch) {
     return strchr(",;:", ch) != NULL;
 }
 
-int isSpecialSymbol(char ch) {
+static int isSpecialSymbol(char ch) {
     return strchr("#.", ch) != NULL;
 }
 
 // Checks if token is a valid data type token (for declaration parsing)
-int isDataTypeToken(const char *token) {
+static int isDataTypeToken(const char *token) {
     const char *dataTypes[] = {
         "int", "float", "char", "double", "void",
         "unsigned", "const", "static", "long", "short", "signed"
@@ -161,35 +249,347 @@ bool isValidIdentifier_Advanced(const char *str) {
     return i + 2 == len;
 }
 
+// Token List Functions
+// Growth functions return false (or -1) when memory runs out and leave the
+// structure as it was; the caller records the failure in its context.
+
+static unsigned long hashString(const char *str, size_t len) {
+    unsigned long hash = 5381;  // djb2
+    for (size_t i = 0; i < len; i++) hash = hash * 33 + (unsigned char)str[i];
+    return hash;
+}
+
+static const char *tokenListGet(const TokenList *list, int index) {
+    return list->arena + list->offsets[index];
+}
+
+// Returns the bucket holding str, or the empty bucket where it belongs
+static int tokenListFindBucket(const TokenList *list, const char *str, size_t len) {
+    int mask = list->bucketCap - 1;
+    int b = (int)(hashString(str, len) & mask);
+    while (list->buckets[b] != 0) {
+        const char *entry = tokenListGet(list, list->buckets[b] - 1);
+        if (strncmp(entry, str, len) == 0 && entry[len] == '\0') break;
+        b = (b + 1) & mask;
+    }
+    return b;
+}
+
+// Returns the ID of str in list, or -1
+static int tokenListFind(const TokenList *list, const char *str) {
+    if (list->count == 0) return -1;
+    int b = tokenListFindBucket(list, str, strlen(str));
+    return list->buckets[b] - 1;
+}
+
+static bool tokenListGrowBuckets(TokenList *list) {
+    int newCap = list->bucketCap ? list->bucketCap * 2 : 64;
+    int *buckets = calloc(newCap, sizeof(int));
+    if (!buckets) return false;
+    free(list->buckets);
+    list->buckets = buckets;
+    list->bucketCap = newCap;
+    for (int i = 0; i < list->count; i++) {
+        const char *entry = tokenListGet(list, i);
+        list->buckets[tokenListFindBucket(list, entry, strlen(entry))] = i + 1;
+    }
+    return true;
+}
+
+// Returns the index of the len bytes at str, appending them if they are new;
+// -1 if there is no memory for a new entry
+static int tokenListIntern(TokenList *list, const char *str, size_t len, bool *added) {
+    *added = false;
+    if ((list->count + 1) * 2 > list->bucketCap && !tokenListGrowBuckets(list)) return -1;
+    int b = tokenListFindBucket(list, str, len);
+    if (list->buckets[b] != 0) return list->buckets[b] - 1;
+
+    if (list->arenaLen + len + 1 > list->arenaCap) {
+        size_t cap = list->arenaCap ? list->arenaCap : 1024;
+        while (cap < list->arenaLen + len + 1) cap *= 2;
+        char *arena = realloc(list->arena, cap);
+        if (!arena) return -1;
+        list->arena = arena;
+        list->arenaCap = cap;
+    }
+    if (list->count == list->cap) {
+        int cap = list->cap ? list->cap * 2 : 64;
+        size_t *offsets = realloc(list->offsets, cap * sizeof(size_t));
+        if (!offsets) return -1;
+        list->offsets = offsets;
+        list->cap = cap;
+    }
+    *added = true;
+    memcpy(list->arena + list->arenaLen, str, len);
+    list->arena[list->arenaLen + len] = '\0';
+    list->offsets[list->count] = list->arenaLen;
+    list->arenaLen += len + 1;
+    list->buckets[b] = ++list->count;
+    return list->count - 1;
+}
+
+static void tokenListReset(TokenList *list) {
+    if (list->count > 0) memset(list->buckets, 0, list->bucketCap * sizeof(int));
+    list->count = 0;
+    list->arenaLen = 0;
+}
+
+static void tokenListFree(TokenList *list) {
+    free(list->arena);
+    free(list->offsets);
+    free(list->buckets);
+    memset(list, 0, sizeof(*list));
+}
+
+static bool idListAppend(IdList *list, unsigned id) {
+    if (list->count == list->cap) {
+        int cap = list->cap ? list->cap * 2 : 64;
+        unsigned *ids = realloc(list->ids, cap * sizeof(unsigned));
+        if (!ids) return false;
+        list->ids = ids;
+        list->cap = cap;
+    }
+    list->ids[list->count++] = id;
+    return true;
+}
+
+// Arrays that were already grown stay grown when a later one fails; the
+// capacity only changes once all four have the new size
+static bool reserveTokenBatch(TokenBatch *batch, size_t extra) {
+    if (batch->count + extra <= batch->cap) return true;
+    size_t cap = batch->cap ? batch->cap : 1024;
+    while (cap < batch->count + extra) cap *= 2;
+    unsigned char *kinds = realloc(batch->kinds, cap);
+    if (!kinds) return false;
+    batch->kinds = kinds;
+    unsigned *ids = realloc(batch->ids, cap * sizeof(unsigned));
+    if (!ids) return false;
+    batch->ids = ids;
+    size_t *offsets = realloc(batch->offsets, cap * sizeof(size_t));
+    if (!offsets) return false;
+    batch->offsets = offsets;
+    unsigned *lengths = realloc(batch->lengths, cap * sizeof(unsigned));
+    if (!lengths) return false;
+    batch->lengths = lengths;
+    batch->cap = cap;
+    return true;
+}
+
+static void freeTokenBatch(TokenBatch *batch) {
+    free(batch->kinds);
+    free(batch->ids);
+    free(batch->offsets);
+    free(batch->lengths);
+    memset(batch, 0, sizeof(*batch));
+}
+
+static bool reserveLineTokens(LineTokens *out, size_t lineLen) {
+    out->count = 0;
+    if (lineLen + 1 > (size_t)out->cap) {
+        int cap = (int)lineLen + 1;
+        int *starts = realloc(out->starts, cap * sizeof(int));
+        if (!starts) return false;
+        out->starts = starts;
+        int *lengths = realloc(out->lengths, cap * sizeof(int));
+        if (!lengths) return false;
+        out->lengths = lengths;
+        out->cap = cap;
+    }
+    return true;
+}
+
+static void freeLineTokens(LineTokens *out) {
+    free(out->starts);
+    free(out->lengths);
+    memset(out, 0, sizeof(*out));
+}
+
 // Symbol Table Functions
 
-int alreadyInSymbolTable(const char *name) {
-    for (int i = 0; i < symbolCount; i++) {
-        if (strcmp(symbolTable[i].name, name) == 0)
-            return 1;
+static int alreadyInSymbolTable(const LexerContext *ctx, unsigned id) {
+    return (ctx->idFlags[id] & ID_SYMBOL) != 0;
+}
+
+static void addToSymbolTable(LexerContext *ctx, const char *type, unsigned id, const char *value, int line) {
+    if (alreadyInSymbolTable(ctx, id)) return;
+    if (ctx->symbolCount == ctx->symbolCap) {
+        int cap = ctx->symbolCap ? ctx->symbolCap * 2 : 64;
+        Symbol *table = realloc(ctx->symbolTable, cap * sizeof(Symbol));
+        if (!table) {
+            ctx->error = LEXER_OUT_OF_MEMORY;
+            return;
+        }
+        ctx->symbolTable = table;
+        ctx->symbolCap = cap;
     }
-    return 0;
+    ctx->idFlags[id] |= ID_SYMBOL;
+    Symbol *symbol = &ctx->symbolTable[ctx->symbolCount++];
+    memset(symbol, 0, sizeof(*symbol));
+    strncpy(symbol->type, type, sizeof(symbol->type)-1);
+    strncpy(symbol->name, tokenListGet(&ctx->interned, id), sizeof(symbol->name)-1);
+    strncpy(symbol->value, value, sizeof(symbol->value)-1);
+    symbol->line = line;
+}
+
+// Lexer Context Functions
+
+LexerContext *createLexerContext(void) {
+    LexerContext *ctx = calloc(1, sizeof(LexerContext));
+    if (!ctx) return NULL;
+    ctx->lineCap = MAX_LINE;
+    ctx->line = malloc(ctx->lineCap);
+    ctx->lineStartCap = 1024;
+    ctx->lineStarts = malloc(ctx->lineStartCap * sizeof(size_t));
+    if (!ctx->line || !ctx->lineStarts) {
+        free(ctx->line);
+        free(ctx->lineStarts);
+        free(ctx);
+        return NULL;
+    }
+    ctx->lineStarts[0] = 0;
+    ctx->lineStartCount = 1;
+    return ctx;
+}
+
+void resetLexerContext(LexerContext *ctx) {
+    ctx->symbolCount = 0;
+    tokenListReset(&ctx->interned);
+    for (int c = 0; c < CATEGORY_COUNT; c++) ctx->categories[c].count = 0;
+    ctx->tokens.count = 0;
+    ctx->lineStarts[0] = 0;
+    ctx->lineStartCount = 1;
+    ctx->lineLen = 0;
+    ctx->inputOffset = 0;
+    ctx->lineno = 0;
+    ctx->insideComment = 0;
+    ctx->error = NULL;
+}
+
+void destroyLexerContext(LexerContext *ctx) {
+    if (!ctx) return;
+    free(ctx->symbolTable);
+    tokenListFree(&ctx->interned);
+    free(ctx->idKinds);
+    free(ctx->idFlags);
+    free(ctx->idHashes);
+    for (int c = 0; c < CATEGORY_COUNT; c++) free(ctx->categories[c].ids);
+    freeTokenBatch(&ctx->tokens);
+    free(ctx->lineStarts);
+    freeLineTokens(&ctx->lineTokens);
+    free(ctx->lineText);
+    free(ctx->line);
+    free(ctx);
+}
+
+void attachTokenStats(LexerContext *ctx, TokenStats *stats) {
+    ctx->stats = stats;
+}
+
+void setStatisticsOnly(LexerContext *ctx, bool statisticsOnly) {
+    ctx->statisticsOnly = statisticsOnly;
+}
+
+void setReferenceTokenizer(LexerContext *ctx, bool reference) {
+    ctx->referenceTokenizer = reference;
+}
+
+const char *getLexerError(const LexerContext *ctx) {
+    return ctx->error;
+}
+
+int getSymbolCount(const LexerContext *ctx) {
+    return ctx->symbolCount;
+}
+
+const Symbol *getSymbol(const LexerContext *ctx, int index) {
+    return (index >= 0 && index < ctx->symbolCount) ? &ctx->symbolTable[index] : NULL;
 }
 
-void addToSymbolTable(const char *type, const char *name, const char *value, int line) {
-    if (!alreadyInSymbolTable(name)) {
-        strncpy(symbolTable[symbolCount].type, type, sizeof(symbolTable[symbolCount].type)-1);
-        strncpy(symbolTable[symbolCount].name, name, sizeof(symbolTable[symbolCount].name)-1);
-        strncpy(symbolTable[symbolCount].value, value, sizeof(symbolTable[symbolCount].value)-1);
-        symbolTable[symbolCount].line = line;
-        symbolCount++;
+int getCategoryCount(const LexerContext *ctx, TokenCategory category) {
+    return ctx->categories[category].count;
+}
+
+const char *getCategoryEntry(const LexerContext *ctx, TokenCategory category, int index) {
+    const IdList *list = &ctx->categories[category];
+    return (index >= 0 && index < list->count) ? tokenListGet(&ctx->interned, list->ids[index]) : NULL;
+}
+
+// Histogram of token kinds in one pass: counts[kind] is the number of tokens of that kind
+static void countKinds(const unsigned char *kinds, size_t n, size_t counts[CATEGORY_COUNT]) {
+    for (int c = 0; c < CATEGORY_COUNT; c++) counts[c] = 0;
+    for (size_t t = 0; t < n; t++) counts[kinds[t]]++;
+}
+
+// Counts how often each category occurs in the token stream
+void countCategoryOccurrences(const LexerContext *ctx, size_t counts[CATEGORY_COUNT]) {
+    const unsigned *ids = ctx->tokens.ids;
+    size_t n = ctx->tokens.count;
+    countKinds(ctx->tokens.kinds, n, counts);
+    // Identifier verdicts are per ID, so these two need the ID flags
+    size_t valid = 0, invalid = 0;
+    for (size_t t = 0; t < n; t++) {
+        unsigned char flags = ctx->idFlags[ids[t]];
+        valid += (flags & ID_VALID) != 0;
+        invalid += (flags & ID_INVALID) != 0;
+    }
+    counts[CATEGORY_VALID_IDENTIFIER] = valid;
+    counts[CATEGORY_INVALID_IDENTIFIER] = invalid;
+}
+
+size_t getTokenCount(const LexerContext *ctx) {
+    return ctx->tokens.count;
+}
+
+size_t getTokenOffset(const LexerContext *ctx, size_t index) {
+    return ctx->tokens.offsets[index];
+}
+
+unsigned getTokenLength(const LexerContext *ctx, size_t index) {
+    return ctx->tokens.lengths[index];
+}
+
+TokenCategory getTokenCategory(const LexerContext *ctx, size_t index) {
+    return (TokenCategory)ctx->tokens.kinds[index];
+}
+
+unsigned getTokenId(const LexerContext *ctx, size_t index) {
+    return ctx->tokens.ids[index];
+}
+
+const char *getInternedText(const LexerContext *ctx, unsigned id) {
+    return tokenListGet(&ctx->interned, (int)id);
+}
+
+// Binary search of the line index: the last line starting at or before offset
+void getLineColumn(const LexerContext *ctx, size_t offset, int *line, int *column) {
+    size_t lo = 0, hi = ctx->lineStartCount;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ctx->lineStarts[mid] <= offset) lo = mid;
+        else hi = mid;
     }
+    *line = (int)(lo + 1);
+    *column = (int)(offset - ctx->lineStarts[lo] + 1);
 }
 
 // Tokenization Helper
 
-int tokenizeLine(char *line, char tokens[][100]) {
-    int tokenIndex = 0;
+static void emitToken(LineTokens *out, int start, int length) {
+    out->starts[out->count] = start;
+    out->lengths[out->count] = length;
+    out->count++;
+}
+
+// Reference tokenizer: the original character-by-character rules. Kept as the
+// specification that tokenizeLineFast is checked against (see fuzz_tokenizer.c).
+static int tokenizeLine(const char *line, LineTokens *out) {
     int i = 0;
     int len = strlen(line);
+    if (!reserveLineTokens(out, len)) return -1;
     while (i < len) {
+        unsigned char ch = (unsigned char)line[i];
         // Skip whitespace
-        if (isspace(line[i])) {
+        if (isspace(ch)) {
             i++;
             continue;
         }
@@ -198,58 +598,618 @@ int tokenizeLine(char *line, char tokens[][100]) {
         if (i + 1 < len) {
             char twoChar[3] = {line[i], line[i+1], '\0'};
             if (isMultiCharOp(twoChar)) {
-                strcpy(tokens[tokenIndex++], twoChar);
+                emitToken(out, i, 2);
                 i += 2;
                 continue;
             }
         }
 
         // Single char operators, separators, brackets
-        if (isOperatorChar(line[i]) || isSeparator(line[i]) || isBracket(line[i]) || isSpecialSymbol(line[i])) {
-            char oneChar[2] = {line[i], '\0'};
-            strcpy(tokens[tokenIndex++], oneChar);
+        if (isOperatorChar(ch) || isSeparator(ch) || isBracket(ch) || isSpecialSymbol(ch)) {
+            emitToken(out, i, 1);
             i++;
             continue;
         }
 
         // Otherwise read a word/identifier/number literal
         int start = i;
-        if (isalpha(line[i]) || line[i] == '_' || line[i] == '#' || line[i] == '@' || line[i] == '!') {
+        if (isalpha(ch) || ch == '_' || ch == '#' || ch == '@' || ch == '!') {
             // Identifier or keyword
-            while (i < len && (isalnum(line[i]) || line[i] == '_' || line[i] == '@' || line[i] == '!')) i++;
-        } else if (isdigit(line[i])) {
+            while (i < len && (isalnum((unsigned char)line[i]) || line[i] == '_' || line[i] == '@' || line[i] == '!')) i++;
+        } else if (isdigit(ch)) {
             // Number literal (integer or float)
-            while (i < len && (isdigit(line[i]) || line[i] == '.')) i++;
-        } else if (line[i] == '\"') {
+            while (i < len && (isdigit((unsigned char)line[i]) || line[i] == '.')) i++;
+        } else if (ch == '\"') {
             // String literal - read until closing quote
             i++; // skip opening quote
             while (i < len && line[i] != '\"') i++;
             if (i < len) i++; // skip closing quote
-        } else if (line[i] == '\'') {
+        } else if (ch == '\'') {
             // Character literal
             i++; // skip opening quote
             if (i < len && line[i] != '\'') i++; // skip char
             if (i < len && line[i] == '\'') i++; // skip closing quote
         } else {
             // Unknown single char token
-            char oneChar[2] = {line[i], '\0'};
-            strcpy(tokens[tokenIndex++], oneChar);
+            emitToken(out, i, 1);
             i++;
             continue;
         }
         int length = i - start;
         if (length > 0) {
-            strncpy(tokens[tokenIndex], &line[start], length);
-            tokens[tokenIndex][length] = '\0';
-            tokenIndex++;
+            emitToken(out, start, length);
+        }
+    }
+    return out->count;
+}
+
+// Character classes for the fast tokenizer, one table lookup per byte
+#define CHAR_SPACE   0x01
+#define CHAR_PUNCT   0x02  // Operator, separator, bracket or special symbol
+#define CHAR_WORD    0x04  // Starts an identifier: letter, '_' or '@'
+#define CHAR_IDENT   0x08  // Continues an identifier: letter, digit, '_', '@', '!'
+#define CHAR_DIGIT   0x10
+#define CHAR_NUMBER  0x20  // Continues a number: digit or '.'
+
+static unsigned char charClass[256];
+static pthread_once_t charClassOnce = PTHREAD_ONCE_INIT;
+
+static void initCharClasses(void) {
+    for (int c = 1; c < 256; c++) {
+        unsigned char cls = 0;
+        if (isspace(c)) cls |= CHAR_SPACE;
+        if (isOperatorChar((char)c) || isSeparator((char)c) || isBracket((char)c) || isSpecialSymbol((char)c))
+            cls |= CHAR_PUNCT;
+        if (isalpha(c) || c == '_' || c == '@') cls |= CHAR_WORD;
+        if (isalnum(c) || c == '_' || c == '@' || c == '!') cls |= CHAR_IDENT;
+        if (isdigit(c)) cls |= CHAR_DIGIT | CHAR_NUMBER;
+        if (c == '.') cls |= CHAR_NUMBER;
+        charClass[c] = cls;
+    }
+}
+
+// Same as isMultiCharOp for the two characters a, b
+static int isMultiCharOpPair(unsigned char a, unsigned char b) {
+    if (b == '=') return a == '=' || a == '!' || a == '<' || a == '>' || a == '+' || a == '-' || a == '*' || a == '/';
+    return a == b && (a == '+' || a == '-' || a == '&' || a == '|');
+}
+
+// Table-driven tokenizer, produces exactly the token spans of tokenizeLine
+static int tokenizeLineFast(const char *line, int len, LineTokens *out) {
+    pthread_once(&charClassOnce, initCharClasses);
+    if (!reserveLineTokens(out, len)) return -1;
+    const unsigned char *s = (const unsigned char *)line;
+    int i = 0;
+    while (i < len) {
+        unsigned char cls = charClass[s[i]];
+        if (cls & CHAR_SPACE) {
+            i++;
+            continue;
+        }
+        int start = i;
+        if (i + 1 < len && isMultiCharOpPair(s[i], s[i+1])) {
+            i += 2;
+        } else if (cls & CHAR_PUNCT) {
+            i++;
+        } else if (cls & CHAR_WORD) {
+            i++;
+            while (i < len && (charClass[s[i]] & CHAR_IDENT)) i++;
+        } else if (cls & CHAR_DIGIT) {
+            i++;
+            while (i < len && (charClass[s[i]] & CHAR_NUMBER)) i++;
+        } else if (s[i] == '"') {
+            const char *close = memchr(line + i + 1, '"', len - i - 1);
+            i = close ? (int)(close - line) + 1 : len;
+        } else if (s[i] == '\'') {
+            i++;
+            if (i < len && s[i] != '\'') i++;
+            if (i < len && s[i] == '\'') i++;
+        } else {
+            i++;
+        }
+        emitToken(out, start, i - start);
+    }
+    return out->count;
+}
+
+// ==================== Token Statistics ====================
+// Streaming statistics with fixed-size sketches, so memory does not grow with
+// the input, and every part can be merged with the statistics of another file
+// or thread:
+//   - exact occurrence counts per category
+//   - HyperLogLog distinct-count estimate per category
+//   - count-min sketch of the frequencies of all token texts
+//   - space-saving top-K of identifiers and of literals
+
+#define HLL_BITS 12                      // 4096 registers, about 1.6% error
+#define HLL_REGISTERS (1 << HLL_BITS)
+#define CMS_DEPTH 4
+#define CMS_WIDTH 4096                   // Power of two
+#define TOP_K_CAPACITY 64                // Counters per space-saving summary
+#define TOP_K_TEXT 48                    // Stored prefix of each counted token
+#define TOP_K_REPORTED 10
+
+typedef struct {
+    unsigned long long hashes[TOP_K_CAPACITY];
+    unsigned long long counts[TOP_K_CAPACITY];
+    unsigned long long errors[TOP_K_CAPACITY];  // Possible overcount of each entry
+    char texts[TOP_K_CAPACITY][TOP_K_TEXT];
+    int size;
+} TopK;
+
+struct TokenStats {
+    unsigned long long tokens;
+    unsigned long long occurrences[CATEGORY_COUNT];
+    unsigned char distinct[CATEGORY_COUNT][HLL_REGISTERS];
+    unsigned long long cms[CMS_DEPTH][CMS_WIDTH];  // 64-bit like the top-K counts, merged sums must not wrap
+    TopK topIdentifiers;
+    TopK topLiterals;
+};
+
+static const char *categoryNames[CATEGORY_COUNT] = {
+    "Valid Identifiers", "Invalid Identifiers", "Keywords", "Numeric", "String Literals",
+    "Multi-char Operators", "Operators", "Separators", "Brackets", "Special Symbols", "Others"
+};
+
+// Category keys in JSON output
+static const char *categoryKeys[CATEGORY_COUNT] = {
+    "valid_identifiers", "invalid_identifiers", "keywords", "numeric", "string_literals",
+    "multi_char_operators", "operators", "separators", "brackets", "special_symbols", "others"
+};
+
+static void writeJsonString(const char *s, FILE *output) {
+    fputc('"', output);
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') fprintf(output, "\\%c", ch);
+        else if (ch < 0x20) fprintf(output, "\\u%04x", ch);
+        else fputc(ch, output);
+    }
+    fputc('"', output);
+}
+
+// 64-bit token hash: FNV-1a, finished with the splitmix64 mixer so the high
+// bits (HyperLogLog bucket) and low bits (sketch rows) are both well spread
+static unsigned long long hashToken(const char *text) {
+    unsigned long long h = 14695981039346656037ULL;
+    while (*text) {
+        h ^= (unsigned char)*text++;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+TokenStats *createTokenStats(void) {
+    return calloc(1, sizeof(TokenStats));
+}
+
+void resetTokenStats(TokenStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void destroyTokenStats(TokenStats *stats) {
+    free(stats);
+}
+
+static void hllAdd(unsigned char *registers, unsigned long long hash) {
+    unsigned index = (unsigned)(hash >> (64 - HLL_BITS));
+    unsigned long long rest = hash << HLL_BITS;
+    unsigned char rank = 1;
+    while (rank <= 64 - HLL_BITS && !(rest & (1ULL << 63))) {
+        rest <<= 1;
+        rank++;
+    }
+    if (rank > registers[index]) registers[index] = rank;
+}
+
+static double hllEstimate(const unsigned char *registers) {
+    double sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        sum += 1.0 / (double)(1ULL << registers[i]);
+        if (registers[i] == 0) zeros++;
+    }
+    double m = HLL_REGISTERS;
+    double estimate = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+    // Small cardinalities: linear counting over the empty registers
+    if (estimate <= 2.5 * m && zeros > 0) estimate = m * log(m / zeros);
+    return estimate;
+}
+
+static unsigned cmsColumn(unsigned long long hash, int row) {
+    unsigned long long h1 = hash & 0xffffffffULL, h2 = hash >> 32;
+    return (unsigned)((h1 + row * h2) & (CMS_WIDTH - 1));
+}
+
+static void cmsAdd(TokenStats *stats, unsigned long long hash, unsigned long long weight) {
+    for (int row = 0; row < CMS_DEPTH; row++) stats->cms[row][cmsColumn(hash, row)] += weight;
+}
+
+static unsigned long long cmsEstimate(const TokenStats *stats, unsigned long long hash) {
+    unsigned long long best = ~0ULL;
+    for (int row = 0; row < CMS_DEPTH; row++) {
+        unsigned long long count = stats->cms[row][cmsColumn(hash, row)];
+        if (count < best) best = count;
+    }
+    return best;
+}
+
+// Estimated number of occurrences of a token text (never an undercount)
+unsigned long long estimateTokenFrequency(const TokenStats *stats, const char *text) {
+    return cmsEstimate(stats, hashToken(text));
+}
+
+double estimateDistinctTokens(const TokenStats *stats, TokenCategory category) {
+    return hllEstimate(stats->distinct[category]);
+}
+
+static void topKAdd(TopK *top, unsigned long long hash, const char *text, unsigned long long weight) {
+    int slot = -1;
+    for (int i = 0; i < top->size; i++) {
+        if (top->hashes[i] == hash) {
+            top->counts[i] += weight;
+            return;
+        }
+    }
+    if (top->size < TOP_K_CAPACITY) {
+        slot = top->size++;
+        top->counts[slot] = 0;
+        top->errors[slot] = 0;
+    } else {
+        // Space-saving: the new token takes over the smallest counter
+        slot = 0;
+        for (int i = 1; i < top->size; i++)
+            if (top->counts[i] < top->counts[slot]) slot = i;
+        top->errors[slot] = top->counts[slot];
+    }
+    top->hashes[slot] = hash;
+    top->counts[slot] += weight;
+    strncpy(top->texts[slot], text, TOP_K_TEXT - 1);
+    top->texts[slot][TOP_K_TEXT - 1] = '\0';
+}
+
+typedef struct {
+    unsigned long long hash, count, error;
+    const char *text;
+} TopKEntry;
+
+static int compareTopKEntries(const void *a, const void *b) {
+    const TopKEntry *x = a, *y = b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return strcmp(x->text, y->text);
+}
+
+static unsigned long long topKMinimum(const TopK *top) {
+    if (top->size < TOP_K_CAPACITY) return 0;  // Not full: absent tokens were never seen
+    unsigned long long least = top->counts[0];
+    for (int i = 1; i < top->size; i++) if (top->counts[i] < least) least = top->counts[i];
+    return least;
+}
+
+static int findTopKEntry(const TopK *top, unsigned long long hash) {
+    for (int i = 0; i < top->size; i++) if (top->hashes[i] == hash) return i;
+    return -1;
+}
+
+// Mergeable summaries merge: a token missing from one side may still have
+// occurred there up to that side's smallest count, which is added as error
+static void mergeTopK(TopK *into, const TopK *from) {
+    TopKEntry entries[2 * TOP_K_CAPACITY];
+    char texts[2 * TOP_K_CAPACITY][TOP_K_TEXT];
+    unsigned long long minInto = topKMinimum(into), minFrom = topKMinimum(from);
+    int n = 0;
+    for (int i = 0; i < into->size; i++) {
+        int j = findTopKEntry(from, into->hashes[i]);
+        entries[n].hash = into->hashes[i];
+        entries[n].count = into->counts[i] + (j >= 0 ? from->counts[j] : minFrom);
+        entries[n].error = into->errors[i] + (j >= 0 ? from->errors[j] : minFrom);
+        memcpy(texts[n], into->texts[i], TOP_K_TEXT);
+        n++;
+    }
+    for (int j = 0; j < from->size; j++) {
+        if (findTopKEntry(into, from->hashes[j]) >= 0) continue;
+        entries[n].hash = from->hashes[j];
+        entries[n].count = from->counts[j] + minInto;
+        entries[n].error = from->errors[j] + minInto;
+        memcpy(texts[n], from->texts[j], TOP_K_TEXT);
+        n++;
+    }
+    for (int i = 0; i < n; i++) entries[i].text = texts[i];
+    qsort(entries, n, sizeof(TopKEntry), compareTopKEntries);
+
+    into->size = n < TOP_K_CAPACITY ? n : TOP_K_CAPACITY;
+    for (int i = 0; i < into->size; i++) {
+        into->hashes[i] = entries[i].hash;
+        into->counts[i] = entries[i].count;
+        into->errors[i] = entries[i].error;
+        memcpy(into->texts[i], entries[i].text, TOP_K_TEXT);
+    }
+}
+
+void mergeTokenStats(TokenStats *into, const TokenStats *from) {
+    into->tokens += from->tokens;
+    for (int c = 0; c < CATEGORY_COUNT; c++) {
+        into->occurrences[c] += from->occurrences[c];
+        for (int r = 0; r < HLL_REGISTERS; r++)
+            if (from->distinct[c][r] > into->distinct[c][r]) into->distinct[c][r] = from->distinct[c][r];
+    }
+    for (int row = 0; row < CMS_DEPTH; row++)
+        for (int col = 0; col < CMS_WIDTH; col++) into->cms[row][col] += from->cms[row][col];
+    mergeTopK(&into->topIdentifiers, &from->topIdentifiers);
+    mergeTopK(&into->topLiterals, &from->topLiterals);
+}
+
+// Adds one occurrence of a token to the sketches (the caller counts the
+// category occurrences); its text is only read for the top-K
+static void countToken(TokenStats *stats, TokenCategory kind, unsigned long long hash, const char *text) {
+    hllAdd(stats->distinct[kind], hash);
+    cmsAdd(stats, hash, 1);
+    if (kind == CATEGORY_OTHER) {
+        topKAdd(&stats->topIdentifiers, hash, text, 1);
+    } else if (kind == CATEGORY_NUMERIC || kind == CATEGORY_STRING_LITERAL) {
+        topKAdd(&stats->topLiterals, hash, text, 1);
+    }
+}
+
+// Adds tokens [first, first + count) of the context's token stream
+static void updateTokenStats(TokenStats *stats, const LexerContext *ctx, size_t first, size_t count) {
+    const unsigned char *kinds = ctx->tokens.kinds + first;
+    const unsigned *ids = ctx->tokens.ids + first;
+    size_t occurrences[CATEGORY_COUNT];
+    countKinds(kinds, count, occurrences);
+    stats->tokens += count;
+    for (int c = 0; c < CATEGORY_COUNT; c++) stats->occurrences[c] += occurrences[c];
+    for (size_t t = 0; t < count; t++)
+        countToken(stats, kinds[t], ctx->idHashes[ids[t]], tokenListGet(&ctx->interned, ids[t]));
+}
+
+// Sorts the candidates by count and returns how many of them are reported
+static int rankTopK(const TokenStats *stats, const TopK *top, TopKEntry entries[TOP_K_CAPACITY]) {
+    for (int i = 0; i < top->size; i++) {
+        entries[i].hash = top->hashes[i];
+        // The sketch bounds the count from above as well, keep the tighter one
+        unsigned long long sketch = cmsEstimate(stats, top->hashes[i]);
+        entries[i].count = top->counts[i] < sketch ? top->counts[i] : sketch;
+        entries[i].error = top->errors[i];
+        entries[i].text = top->texts[i];
+    }
+    qsort(entries, top->size, sizeof(TopKEntry), compareTopKEntries);
+    return top->size < TOP_K_REPORTED ? top->size : TOP_K_REPORTED;
+}
+
+static void writeTopK(const TokenStats *stats, const TopK *top, const char *title, FILE *output) {
+    TopKEntry entries[TOP_K_CAPACITY];
+    int shown = rankTopK(stats, top, entries);
+    fprintf(output, "%s:\n", title);
+    for (int i = 0; i < shown; i++) {
+        bool cut = strlen(entries[i].text) == TOP_K_TEXT - 1;
+        fprintf(output, "  %2d. %-30s%s %10llu", i + 1, entries[i].text, cut ? "..." : "", entries[i].count);
+        if (entries[i].error > 0) fprintf(output, " (may be %llu lower)", entries[i].error);
+        fprintf(output, "\n");
+    }
+    fprintf(output, "\n");
+}
+
+void writeTokenStats(const TokenStats *stats, FILE *output) {
+    fprintf(output, "\n=========== TOKEN STATISTICS ===========\n\n");
+    fprintf(output, "Total tokens: %llu\n\n", stats->tokens);
+    fprintf(output, "%-22s %12s %12s\n", "Category", "Occurrences", "~Distinct");
+    for (int c = CATEGORY_KEYWORD; c < CATEGORY_COUNT; c++) {
+        fprintf(output, "%-22s %12llu %12.0f\n", categoryNames[c], stats->occurrences[c],
+                stats->occurrences[c] ? hllEstimate(stats->distinct[c]) : 0.0);
+    }
+    fprintf(output, "\n");
+    writeTopK(stats, &stats->topIdentifiers, "Most frequent identifiers", output);
+    writeTopK(stats, &stats->topLiterals, "Most frequent literals", output);
+}
+
+static void writeTopKJson(const TokenStats *stats, const TopK *top, const char *key, FILE *output) {
+    TopKEntry entries[TOP_K_CAPACITY];
+    int shown = rankTopK(stats, top, entries);
+    fprintf(output, ",\"%s\":[", key);
+    for (int i = 0; i < shown; i++) {
+        fprintf(output, "%s{\"text\":", i ? "," : "");
+        writeJsonString(entries[i].text, output);
+        fprintf(output, ",\"count\":%llu,\"error\":%llu}", entries[i].count, entries[i].error);
+    }
+    fprintf(output, "]");
+}
+
+// The statistics as one JSON object on a line of its own
+void writeTokenStatsJson(const TokenStats *stats, FILE *output) {
+    fprintf(output, "{\"stats\":{\"tokens\":%llu,\"categories\":{", stats->tokens);
+    for (int c = CATEGORY_KEYWORD; c < CATEGORY_COUNT; c++) {
+        fprintf(output, "%s\"%s\":{\"occurrences\":%llu,\"distinct\":%.0f}", c > CATEGORY_KEYWORD ? "," : "",
+                categoryKeys[c], stats->occurrences[c], stats->occurrences[c] ? hllEstimate(stats->distinct[c]) : 0.0);
+    }
+    fprintf(output, "}");
+    writeTopKJson(stats, &stats->topIdentifiers, "top_identifiers", output);
+    writeTopKJson(stats, &stats->topLiterals, "top_literals", output);
+    fprintf(output, "}}\n");
+}
+
+// ==================== Input Sources ====================
+// Plain, gzip or zstd input, detected from the first bytes. Compressed input
+// is decompressed chunk by chunk straight into the caller's buffer; nothing is
+// written to disk. Lines and comments that straddle chunks are handled by
+// feedLexer, which carries partial lines over.
+// gzip needs a build with -DLEXER_HAVE_ZLIB (-lz), zstd -DLEXER_HAVE_ZSTD (-lzstd).
+
+#define COMPRESSED_BLOCK_SIZE (256 * 1024)
+
+typedef enum { INPUT_PLAIN, INPUT_GZIP, INPUT_ZSTD } InputFormat;
+
+typedef struct {
+    FILE *file;
+    InputFormat format;
+    unsigned char *buffer;   // Raw bytes read from the file
+    size_t bufferLen;
+    size_t bufferPos;
+    bool done;               // All data has been returned
+    const char *error;       // Set when the input cannot be read
+#ifdef LEXER_HAVE_ZLIB
+    z_stream gz;
+    bool gzMemberEnded;      // Between gzip members: end of file is fine here
+#endif
+#ifdef LEXER_HAVE_ZSTD
+    ZSTD_DStream *zstd;
+    size_t zstdPending;      // Last ZSTD_decompressStream result, 0 = frame complete
+#endif
+} InputSource;
+
+static bool refillInputSource(InputSource *src) {
+    src->bufferLen = fread(src->buffer, 1, COMPRESSED_BLOCK_SIZE, src->file);
+    src->bufferPos = 0;
+    if (src->bufferLen == 0 && ferror(src->file)) src->error = "read error";
+    return src->bufferLen > 0;
+}
+
+// Sets up reading from file; the format is taken from the magic bytes
+static bool openInputSource(InputSource *src, FILE *file) {
+    memset(src, 0, sizeof(*src));
+    src->file = file;
+    src->buffer = malloc(COMPRESSED_BLOCK_SIZE);
+    if (!src->buffer) {
+        src->error = "out of memory";
+        return false;
+    }
+    refillInputSource(src);
+    if (src->error) return false;
+
+    const unsigned char *magic = src->buffer;
+    if (src->bufferLen >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        src->format = INPUT_GZIP;
+#ifdef LEXER_HAVE_ZLIB
+        if (inflateInit2(&src->gz, 15 + 16) != Z_OK) src->error = "could not start gzip decompression";
+#else
+        src->error = "gzip input needs a build with -DLEXER_HAVE_ZLIB";
+#endif
+    } else if (src->bufferLen >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        src->format = INPUT_ZSTD;
+#ifdef LEXER_HAVE_ZSTD
+        src->zstd = ZSTD_createDStream();
+        if (!src->zstd || ZSTD_isError(ZSTD_initDStream(src->zstd))) src->error = "could not start zstd decompression";
+        src->zstdPending = 1;
+#else
+        src->error = "zstd input needs a build with -DLEXER_HAVE_ZSTD";
+#endif
+    }
+    return src->error == NULL;
+}
+
+#ifdef LEXER_HAVE_ZLIB
+static size_t readGzip(InputSource *src, char *out, size_t cap) {
+    size_t produced = 0;
+    while (produced < cap && !src->done && !src->error) {
+        if (src->bufferPos == src->bufferLen && !refillInputSource(src)) {
+            if (!src->error && !src->gzMemberEnded) src->error = "truncated gzip data";
+            src->done = true;
+            break;
+        }
+        src->gz.next_in = src->buffer + src->bufferPos;
+        src->gz.avail_in = (uInt)(src->bufferLen - src->bufferPos);
+        src->gz.next_out = (Bytef *)out + produced;
+        src->gz.avail_out = (uInt)(cap - produced);
+        int result = inflate(&src->gz, Z_NO_FLUSH);
+        produced = cap - src->gz.avail_out;
+        src->bufferPos = src->bufferLen - src->gz.avail_in;
+        if (result == Z_STREAM_END) {
+            // Concatenated gzip members continue after this one
+            src->gzMemberEnded = true;
+            inflateReset(&src->gz);
+        } else if (result == Z_OK || result == Z_BUF_ERROR) {
+            if (src->gz.total_in > 0) src->gzMemberEnded = false;
+        } else {
+            src->error = "corrupt gzip data";
+        }
+    }
+    return produced;
+}
+#endif
+
+#ifdef LEXER_HAVE_ZSTD
+static size_t readZstd(InputSource *src, char *out, size_t cap) {
+    ZSTD_outBuffer output = { out, cap, 0 };
+    while (output.pos < cap && !src->done && !src->error) {
+        bool atEnd = false;
+        if (src->bufferPos == src->bufferLen && !refillInputSource(src)) {
+            if (src->error || src->zstdPending == 0) {
+                src->done = true;
+                break;
+            }
+            atEnd = true;  // One more call with no input flushes buffered output
+        }
+        ZSTD_inBuffer input = { src->buffer, src->bufferLen, src->bufferPos };
+        size_t before = output.pos;
+        src->zstdPending = ZSTD_decompressStream(src->zstd, &output, &input);
+        src->bufferPos = input.pos;
+        if (ZSTD_isError(src->zstdPending)) {
+            src->error = "corrupt zstd data";
+        } else if (atEnd && output.pos == before && src->zstdPending != 0) {
+            src->error = "truncated zstd data";
         }
     }
-    return tokenIndex;
+    return output.pos;
+}
+#endif
+
+// Fills out with up to cap bytes of (decompressed) input. Returns fewer than
+// cap bytes only at the end of the input or on an error (src->error is set).
+static size_t readInputSource(InputSource *src, char *out, size_t cap) {
+    if (src->error || src->done) return 0;
+#ifdef LEXER_HAVE_ZLIB
+    if (src->format == INPUT_GZIP) return readGzip(src, out, cap);
+#endif
+#ifdef LEXER_HAVE_ZSTD
+    if (src->format == INPUT_ZSTD) return readZstd(src, out, cap);
+#endif
+    // Plain input: hand out the sniffed bytes first, then read directly
+    size_t produced = 0;
+    if (src->bufferPos < src->bufferLen) {
+        produced = src->bufferLen - src->bufferPos;
+        if (produced > cap) produced = cap;
+        memcpy(out, src->buffer + src->bufferPos, produced);
+        src->bufferPos += produced;
+    }
+    if (produced < cap) {
+        produced += fread(out + produced, 1, cap - produced, src->file);
+        if (ferror(src->file)) src->error = "read error";
+    }
+    if (produced < cap) src->done = true;
+    return produced;
+}
+
+static void closeInputSource(InputSource *src) {
+#ifdef LEXER_HAVE_ZLIB
+    if (src->format == INPUT_GZIP) inflateEnd(&src->gz);
+#endif
+#ifdef LEXER_HAVE_ZSTD
+    if (src->zstd) ZSTD_freeDStream(src->zstd);
+#endif
+    free(src->buffer);
+    src->buffer = NULL;
 }
 
 // ==================== Processing Declarations ====================
 
-void processDeclarationTokens(char tokens[][100], int startIndex, int tokenCount, const char *fullType, int lineno) {
+// Lists an identifier token as valid or invalid, once per distinct name
+static void addIdentifier(LexerContext *ctx, TokenCategory category, unsigned id) {
+    unsigned char flag = category == CATEGORY_VALID_IDENTIFIER ? ID_VALID : ID_INVALID;
+    if (ctx->idFlags[id] & flag) return;
+    if (!idListAppend(&ctx->categories[category], id)) {
+        ctx->error = LEXER_OUT_OF_MEMORY;
+        return;
+    }
+    ctx->idFlags[id] |= flag;
+}
+
+// tokens[] holds the text and ids[] the intern ID of each token of the line
+static void processDeclarationTokens(LexerContext *ctx, const char **tokens, const unsigned *ids, int startIndex, int tokenCount, const char *fullType, int lineno) {
     int i = startIndex;
     while (i < tokenCount) {
         // Skip commas
@@ -260,50 +1220,31 @@ void processDeclarationTokens(char tokens[][100], int startIndex, int tokenCount
         // End if semicolon
         if (strcmp(tokens[i], ";") == 0) break;
 
-        char varName[100] = "";
-        char varValue[100] = "-";
+        const char *varValue = "-";
 
         // The next token should be a potential identifier (variable name)
         if (isValidIdentifier_Advanced(tokens[i])) {
-            strcpy(varName, tokens[i]);
+            unsigned varId = ids[i];
             // Add to valid identifiers
-            int found = 0;
-            for (int k = 0; k < validIdentifiersCount; k++) {
-                if (strcmp(validIdentifiers[k], varName) == 0) {
-                    found = 1;
-                    break;
-                }
-            }
-            if (!found) {
-                strcpy(validIdentifiers[validIdentifiersCount++], varName);
-            }
+            addIdentifier(ctx, CATEGORY_VALID_IDENTIFIER, varId);
             i++;
 
             // Check if initialization: =
             if (i < tokenCount && strcmp(tokens[i], "=") == 0) {
                 i++;
                 if (i < tokenCount) {
-                    strcpy(varValue, tokens[i]);
+                    varValue = tokens[i];
                     i++;
                 }
             }
 
-            addToSymbolTable(fullType, varName, varValue, lineno);
+            addToSymbolTable(ctx, fullType, varId, varValue, lineno);
         } else {
             // Only add to invalid identifiers if it could be a variable name
             if (!isKeyword(tokens[i]) && !isOperatorString(tokens[i]) && !isBracket(tokens[i][0]) &&
                 !isSeparator(tokens[i][0]) && !isSpecialSymbol(tokens[i][0]) && !isdigit(tokens[i][0]) &&
                 tokens[i][0] != '"' && tokens[i][0] != '\'') {
-                int found = 0;
-                for (int k = 0; k < invalidIdentifiersCount; k++) {
-                    if (strcmp(invalidIdentifiers[k], tokens[i]) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    strcpy(invalidIdentifiers[invalidIdentifiersCount++], tokens[i]);
-                }
+                addIdentifier(ctx, CATEGORY_INVALID_IDENTIFIER, ids[i]);
             }
             i++;
         }
@@ -312,270 +1253,283 @@ void processDeclarationTokens(char tokens[][100], int startIndex, int tokenCount
 
 // ==================== Main Lexical Analyzer ====================
 
-void processFile(FILE *input, FILE *output) {
-    char line[MAX_LINE];
-    int lineno = 0;
-
-    // To accumulate all tokens for token categories output
-    char keywordsFound[1000][100];
-    int keywordsCount = 0;
-
-    char numericsFound[1000][100];
-    int numericsCount = 0;
-
-    char stringLiteralsFound[1000][1000];
-    int stringLiteralsCount = 0;
-
-    char multiCharOpsFound[1000][10];
-    int multiCharOpsCount = 0;
+// Returns the report category of a token outside declaration context
+static TokenCategory classifyToken(const char *token) {
+    size_t len = strlen(token);
+    if (isKeyword(token)) return CATEGORY_KEYWORD;
+    if (isMultiCharOp(token)) return CATEGORY_MULTI_CHAR_OPERATOR;
+    if (isOperatorString(token)) return CATEGORY_OPERATOR;
+    if (len == 1 && isSeparator(token[0])) return CATEGORY_SEPARATOR;
+    if (len == 1 && isBracket(token[0])) return CATEGORY_BRACKET;
+    if (len == 1 && isSpecialSymbol(token[0])) return CATEGORY_SPECIAL_SYMBOL;
+    // String and character literals
+    if (token[0] == '"' && token[len-1] == '"') return CATEGORY_STRING_LITERAL;
+    if (token[0] == '\'' && token[len-1] == '\'') return CATEGORY_STRING_LITERAL;
+    if (isdigit(token[0])) return CATEGORY_NUMERIC;
+    // Identifiers are only checked in declaration contexts
+    return CATEGORY_OTHER;
+}
 
-    char operatorsFound[1000][10];
-    int operatorsCount = 0;
+static bool growIdTables(LexerContext *ctx) {
+    int cap = ctx->idCap ? ctx->idCap * 2 : 1024;
+    unsigned char *kinds = realloc(ctx->idKinds, cap);
+    if (!kinds) return false;
+    ctx->idKinds = kinds;
+    unsigned char *flags = realloc(ctx->idFlags, cap);
+    if (!flags) return false;
+    ctx->idFlags = flags;
+    unsigned long long *hashes = realloc(ctx->idHashes, cap * sizeof(unsigned long long));
+    if (!hashes) return false;
+    ctx->idHashes = hashes;
+    ctx->idCap = cap;
+    return true;
+}
 
-    char separatorsFound[1000][10];
-    int separatorsCount = 0;
+// Returns the intern ID of a token, classifying it the first time it is seen.
+// A new ID is also the token's first occurrence, so it is appended to its
+// category here and the category lists need no separate dedup pass.
+// Returns -1 when memory runs out.
+static int internToken(LexerContext *ctx, const char *text, int len) {
+    bool added;
+    int id = tokenListIntern(&ctx->interned, text, len, &added);
+    if (id < 0) return -1;
+    if (added) {
+        if (id >= ctx->idCap && !growIdTables(ctx)) return -1;
+        TokenCategory kind = classifyToken(tokenListGet(&ctx->interned, id));
+        ctx->idKinds[id] = (unsigned char)kind;
+        ctx->idFlags[id] = 0;
+        ctx->idHashes[id] = hashToken(tokenListGet(&ctx->interned, id));
+        if (!idListAppend(&ctx->categories[kind], id)) return -1;
+    }
+    return id;
+}
 
-    char bracketsFound[1000][10];
-    int bracketsCount = 0;
+// Statistics-only counting: each token is classified and hashed where it lies
+// in the line, so nothing is interned and memory does not grow with the input
+static void updateTokenStatsFromLine(TokenStats *stats, char *line, const LineTokens *spans) {
+    stats->tokens += spans->count;
+    for (int t = 0; t < spans->count; t++) {
+        char *text = line + spans->starts[t];
+        char *end = text + spans->lengths[t];
+        char saved = *end;
+        *end = '\0';
+        TokenCategory kind = classifyToken(text);
+        stats->occurrences[kind]++;
+        countToken(stats, kind, hashToken(text), text);
+        *end = saved;
+    }
+}
 
-    char specialSymbolsFound[1000][10];
-    int specialSymbolsCount = 0;
+// Analyzes one source line (without its newline) that starts at byte lineOffset
+// of the input; the line is modified in place
+static void processLine(LexerContext *ctx, char *line, size_t lineOffset) {
+    ctx->lineno++;
+    int lineno = ctx->lineno;
+
+    // Handle multi-line comments /* ... */
+    if (ctx->insideComment) {
+        char *endComment = strstr(line, "*/");
+        if (endComment) {
+            ctx->insideComment = 0;
+            lineOffset += endComment + 2 - line;
+            memmove(line, endComment + 2, strlen(endComment + 2) + 1);
+        } else {
+            return;
+        }
+    }
+    char *startComment = strstr(line, "/*");
+    if (startComment) {
+        ctx->insideComment = 1;
+        *startComment = '\0';
+    }
 
-    // Multi-line comment handling
-    int insideComment = 0;
+    // Remove single-line comments (//)
+    char *comment = strstr(line, "//");
+    if (comment) *comment = '\0';
 
-    while (fgets(line, sizeof(line), input)) {
-        lineno++;
+    // Tokenize line
+    const LineTokens *spans = &ctx->lineTokens;
+    int tokenCount = ctx->referenceTokenizer ? tokenizeLine(line, &ctx->lineTokens)
+                                             : tokenizeLineFast(line, strlen(line), &ctx->lineTokens);
 
-        // Remove newline at end
-        line[strcspn(line, "\n")] = 0;
+    if (tokenCount == 0) return;
+    if (tokenCount > 0 && ctx->statisticsOnly) {
+        if (ctx->stats) updateTokenStatsFromLine(ctx->stats, line, spans);
+        return;
+    }
 
-        // Handle multi-line comments /* ... */
-        if (insideComment) {
-            char *endComment = strstr(line, "*/");
-            if (endComment) {
-                insideComment = 0;
-                memmove(line, endComment + 2, strlen(endComment + 2) + 1);
-            } else {
-                continue;
-            }
+    // Append the line's tokens to the token stream
+    TokenBatch *batch = &ctx->tokens;
+    if (tokenCount < 0 || !reserveTokenBatch(batch, tokenCount)) {
+        ctx->error = LEXER_OUT_OF_MEMORY;
+        return;
+    }
+    size_t first = batch->count;
+    for (int t = 0; t < tokenCount; t++) {
+        int id = internToken(ctx, line + spans->starts[t], spans->lengths[t]);
+        if (id < 0) {
+            ctx->error = LEXER_OUT_OF_MEMORY;
+            return;
         }
-        char *startComment = strstr(line, "/*");
-        if (startComment) {
-            insideComment = 1;
-            *startComment = '\0';
+        batch->kinds[first + t] = ctx->idKinds[id];
+        batch->ids[first + t] = id;
+        batch->offsets[first + t] = lineOffset + spans->starts[t];
+        batch->lengths[first + t] = spans->lengths[t];
+    }
+    batch->count += tokenCount;
+
+    // Token text for the declaration rules, taken from the intern table
+    // (looked up after interning the whole line, as interning may move it)
+    if (tokenCount > ctx->lineTextCap) {
+        const char **lineText = realloc(ctx->lineText, tokenCount * sizeof(char *));
+        if (!lineText) {
+            ctx->error = LEXER_OUT_OF_MEMORY;
+            return;
         }
-
-        // Remove single-line comments (//)
-        char *comment = strstr(line, "//");
-        if (comment) *comment = '\0';
-
-        // Tokenize line
-        char tokens[MAX_TOKENS_PER_LINE][100];
-        int tokenCount = tokenizeLine(line, tokens);
-
-        if (tokenCount == 0) continue;
-
-        // Check if this line starts with data type tokens for declaration
-        int dataTypeTokensLen = 0;
-        char dataTypeBuffer[100] = "";
-        int i;
-        bool isFunctionDecl = false;
-        for (i = 0; i < tokenCount; i++) {
-            if (isDataTypeToken(tokens[i])) {
+        ctx->lineText = lineText;
+        ctx->lineTextCap = tokenCount;
+    }
+    const char **tokens = ctx->lineText;
+    const unsigned *ids = batch->ids + first;
+    for (int t = 0; t < tokenCount; t++) tokens[t] = tokenListGet(&ctx->interned, ids[t]);
+
+    // Check if this line starts with data type tokens for declaration
+    int dataTypeTokensLen = 0;
+    char dataTypeBuffer[100] = "";
+    int i;
+    bool isFunctionDecl = false;
+    for (i = 0; i < tokenCount; i++) {
+        if (isDataTypeToken(tokens[i])) {
+            // Longer type lists than the buffer holds are cut off
+            size_t used = strlen(dataTypeBuffer);
+            if (used + strlen(tokens[i]) + 2 <= sizeof(dataTypeBuffer)) {
                 if (dataTypeTokensLen > 0) strcat(dataTypeBuffer, " ");
                 strcat(dataTypeBuffer, tokens[i]);
-                dataTypeTokensLen++;
-            } else if (dataTypeTokensLen > 0 && i + 1 < tokenCount && strcmp(tokens[i+1], "(") == 0) {
-                // Function declaration detected
-                isFunctionDecl = true;
-                break;
-            } else {
-                break;
             }
+            dataTypeTokensLen++;
+        } else if (dataTypeTokensLen > 0 && i + 1 < tokenCount && strcmp(tokens[i+1], "(") == 0) {
+            // Function declaration detected
+            isFunctionDecl = true;
+            break;
+        } else {
+            break;
         }
+    }
 
-        // Process declarations (variables or functions)
-        if (dataTypeTokensLen > 0 && dataTypeTokensLen < tokenCount) {
-            if (isFunctionDecl) {
-                // Handle function declaration
-                if (isValidIdentifier_Advanced(tokens[i])) {
-                    int found = 0;
-                    for (int k = 0; k < validIdentifiersCount; k++) {
-                        if (strcmp(validIdentifiers[k], tokens[i]) == 0) {
-                            found = 1;
-                            break;
-                        }
-                    }
-                    if (!found) {
-                        strcpy(validIdentifiers[validIdentifiersCount++], tokens[i]);
-                    }
-                    addToSymbolTable(dataTypeBuffer, tokens[i], "-", lineno);
-                } else {
-                    int found = 0;
-                    for (int k = 0; k < invalidIdentifiersCount; k++) {
-                        if (strcmp(invalidIdentifiers[k], tokens[i]) == 0) {
-                            found = 1;
-                            break;
-                        }
-                    }
-                    if (!found) {
-                        strcpy(invalidIdentifiers[invalidIdentifiersCount++], tokens[i]);
-                    }
-                }
+    // Process declarations (variables or functions)
+    if (dataTypeTokensLen > 0 && dataTypeTokensLen < tokenCount) {
+        if (isFunctionDecl) {
+            // Handle function declaration
+            if (isValidIdentifier_Advanced(tokens[i])) {
+                addIdentifier(ctx, CATEGORY_VALID_IDENTIFIER, ids[i]);
+                addToSymbolTable(ctx, dataTypeBuffer, ids[i], "-", lineno);
             } else {
-                // Handle variable declarations
-                processDeclarationTokens(tokens, dataTypeTokensLen, tokenCount, dataTypeBuffer, lineno);
+                addIdentifier(ctx, CATEGORY_INVALID_IDENTIFIER, ids[i]);
             }
+        } else {
+            // Handle variable declarations
+            processDeclarationTokens(ctx, tokens, ids, dataTypeTokensLen, tokenCount, dataTypeBuffer, lineno);
         }
+    }
+    // Token categories were filled in by internToken
 
-        // Process all tokens for token categories
-        for (int t = 0; t < tokenCount; t++) {
-            char *token = tokens[t];
+    if (ctx->stats) updateTokenStats(ctx->stats, ctx, first, tokenCount);
+}
 
-            // Skip empty tokens
-            if (strlen(token) == 0) continue;
+static bool appendToLine(LexerContext *ctx, const char *data, size_t len) {
+    if (ctx->lineLen + len + 1 > ctx->lineCap) {
+        size_t cap = ctx->lineCap;
+        while (cap < ctx->lineLen + len + 1) cap *= 2;
+        char *line = realloc(ctx->line, cap);
+        if (!line) return false;
+        ctx->line = line;
+        ctx->lineCap = cap;
+    }
+    memcpy(ctx->line + ctx->lineLen, data, len);
+    ctx->lineLen += len;
+    ctx->line[ctx->lineLen] = '\0';
+    return true;
+}
 
-            // Keywords
-            if (isKeyword(token)) {
-                int found = 0;
-                for (int k = 0; k < keywordsCount; k++) {
-                    if (strcmp(keywordsFound[k], token) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found && strlen(token) < 100) {
-                    strcpy(keywordsFound[keywordsCount++], token);
-                }
-                continue;
-            }
-            // Multi-char operators
-            if (isMultiCharOp(token)) {
-                int found = 0;
-                for (int k = 0; k < multiCharOpsCount; k++) {
-                    if (strcmp(multiCharOpsFound[k], token) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    strcpy(multiCharOpsFound[multiCharOpsCount++], token);
-                }
-                continue;
-            }
-            // Single char operators
-            if (isOperatorString(token)) {
-                int found = 0;
-                for (int k = 0; k < operatorsCount; k++) {
-                    if (strcmp(operatorsFound[k], token) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    strcpy(operatorsFound[operatorsCount++], token);
-                }
-                continue;
-            }
-            // Separators
-            if (strlen(token) == 1 && isSeparator(token[0])) {
-                int found = 0;
-                for (int k = 0; k < separatorsCount; k++) {
-                    if (strcmp(separatorsFound[k], token) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    strcpy(separatorsFound[separatorsCount++], token);
-                }
-                continue;
-            }
-            // Brackets
-            if (strlen(token) == 1 && isBracket(token[0])) {
-                int found = 0;
-                for (int k = 0; k < bracketsCount; k++) {
-                    if (strcmp(bracketsFound[k], token) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    strcpy(bracketsFound[bracketsCount++], token);
-                }
-                continue;
-            }
-            // Special symbols
-            if (strlen(token) == 1 && isSpecialSymbol(token[0])) {
-                int found = 0;
-                for (int k = 0; k < specialSymbolsCount; k++) {
-                    if (strcmp(specialSymbolsFound[k], token) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    strcpy(specialSymbolsFound[specialSymbolsCount++], token);
-                }
-                continue;
-            }
-            // String literals
-            if (token[0] == '"' && token[strlen(token)-1] == '"') {
-                int found = 0;
-                for (int k = 0; k < stringLiteralsCount; k++) {
-                    if (strcmp(stringLiteralsFound[k], token) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    strcpy(stringLiteralsFound[stringLiteralsCount++], token);
-                }
-                continue;
-            }
-            // Character literals
-            if (token[0] == '\'' && token[strlen(token)-1] == '\'') {
-                int found = 0;
-                for (int k = 0; k < stringLiteralsCount; k++) {
-                    if (strcmp(stringLiteralsFound[k], token) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    strcpy(stringLiteralsFound[stringLiteralsCount++], token);
-                }
-                continue;
-            }
-            // Numeric literals
-            if (isdigit(token[0])) {
-                int found = 0;
-                for (int k = 0; k < numericsCount; k++) {
-                    if (strcmp(numericsFound[k], token) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    strcpy(numericsFound[numericsCount++], token);
-                }
-                continue;
-            }
-            // Identifiers are only checked in declaration contexts
-            // Tokens not in any category
-            int found = 0;
-            for (int k = 0; k < othersCount; k++) {
-                if (strcmp(othersFound[k], token) == 0) {
-                    found = 1;
-                    break;
+// Consumes the next chunk of input. Chunks may end anywhere; a partial last
+// line is kept until the rest of it arrives. The line index is extended here,
+// one memchr per line. Once a call has failed, the run stays failed until
+// the context is reset.
+int feedLexer(LexerContext *ctx, const char *data, size_t len) {
+    if (ctx->error) return 1;
+    const char *end = data + len;
+    while (data < end) {
+        const char *nl = memchr(data, '\n', end - data);
+        if (!appendToLine(ctx, data, (nl ? nl : end) - data)) {
+            ctx->error = LEXER_OUT_OF_MEMORY;
+            return 1;
+        }
+        if (!nl) {
+            ctx->inputOffset += end - data;
+            break;
+        }
+        ctx->inputOffset += nl + 1 - data;
+        data = nl + 1;
+
+        size_t lineOffset = ctx->lineStarts[ctx->lineStartCount - 1];
+        if (!ctx->statisticsOnly) {
+            if (ctx->lineStartCount == ctx->lineStartCap) {
+                size_t *lineStarts = realloc(ctx->lineStarts, ctx->lineStartCap * 2 * sizeof(size_t));
+                if (!lineStarts) {
+                    ctx->error = LEXER_OUT_OF_MEMORY;
+                    return 1;
                 }
+                ctx->lineStarts = lineStarts;
+                ctx->lineStartCap *= 2;
             }
-            if (!found) {
-                strcpy(othersFound[othersCount++], token);
-            }
+            ctx->lineStarts[ctx->lineStartCount++] = ctx->inputOffset;
+        }
+
+        processLine(ctx, ctx->line, lineOffset);
+        ctx->lineLen = 0;
+        if (ctx->error) return 1;
+    }
+    return 0;
+}
+
+// Analyzes the last line if the input did not end with a newline
+int finishLexer(LexerContext *ctx) {
+    if (ctx->error) return 1;
+    if (ctx->lineLen > 0) {
+        processLine(ctx, ctx->line, ctx->lineStarts[ctx->lineStartCount - 1]);
+        ctx->lineLen = 0;
+    }
+    return ctx->error ? 1 : 0;
+}
+
+int analyzeFile(LexerContext *ctx, FILE *input) {
+    char block[READ_BLOCK_SIZE];
+    InputSource src;
+    if (openInputSource(&src, input)) {
+        size_t got;
+        while ((got = readInputSource(&src, block, sizeof(block))) > 0) {
+            if (feedLexer(ctx, block, got) != 0) break;
         }
     }
+    if (src.error && !ctx->error) ctx->error = src.error;
+    closeInputSource(&src);
+    return finishLexer(ctx);
+}
+
+int analyzeBuffer(LexerContext *ctx, const char *data, size_t len) {
+    feedLexer(ctx, data, len);
+    return finishLexer(ctx);
+}
+
+static void printCategory(FILE *output, const LexerContext *ctx, TokenCategory category) {
+    const IdList *list = &ctx->categories[category];
+    for (int i = 0; i < list->count; i++) {
+        fprintf(output, "%s%s", tokenListGet(&ctx->interned, list->ids[i]), (i == list->count -1) ? "" : ", ");
+    }
+}
+
+void writeReport(const LexerContext *ctx, FILE *output) {
+    const IdList *categories = ctx->categories;
 
     // Print to output.txt
     fprintf(output, "***************************************************\n");
@@ -584,16 +1538,12 @@ void processFile(FILE *input, FILE *output) {
     fprintf(output, "***************************************************\n\n");
 
     // Print Valid and Invalid Identifiers
-    fprintf(output, "Valid Variables/Identifiers (Count: %d): [", validIdentifiersCount);
-    for (int i = 0; i < validIdentifiersCount; i++) {
-        fprintf(output, "%s%s", validIdentifiers[i], (i == validIdentifiersCount -1) ? "" : ", ");
-    }
+    fprintf(output, "Valid Variables/Identifiers (Count: %d): [", categories[CATEGORY_VALID_IDENTIFIER].count);
+    printCategory(output, ctx, CATEGORY_VALID_IDENTIFIER);
     fprintf(output, "]\n\n");
 
-    fprintf(output, "Invalid Variables/Identifiers (Count: %d): [", invalidIdentifiersCount);
-    for (int i = 0; i < invalidIdentifiersCount; i++) {
-        fprintf(output, "%s%s", invalidIdentifiers[i], (i == invalidIdentifiersCount -1) ? "" : ", ");
-    }
+    fprintf(output, "Invalid Variables/Identifiers (Count: %d): [", categories[CATEGORY_INVALID_IDENTIFIER].count);
+    printCategory(output, ctx, CATEGORY_INVALID_IDENTIFIER);
     fprintf(output, "]\n\n");
 
     // Print all tokens by category
@@ -601,72 +1551,52 @@ void processFile(FILE *input, FILE *output) {
 
     // Print Keywords
     fprintf(output, "Keywords: [");
-    for (int i = 0; i < keywordsCount; i++) {
-        fprintf(output, "%s%s", keywordsFound[i], (i == keywordsCount -1) ? "" : ", ");
-    }
+    printCategory(output, ctx, CATEGORY_KEYWORD);
     fprintf(output, "]\n\n");
 
     // Print Identifiers (valid ones)
     fprintf(output, "Identifiers: [");
-    for (int i = 0; i < validIdentifiersCount; i++) {
-        fprintf(output, "%s%s", validIdentifiers[i], (i == validIdentifiersCount -1) ? "" : ", ");
-    }
+    printCategory(output, ctx, CATEGORY_VALID_IDENTIFIER);
     fprintf(output, "]\n\n");
 
     // Print Numeric literals
     fprintf(output, "Numeric: [");
-    for (int i = 0; i < numericsCount; i++) {
-        fprintf(output, "%s%s", numericsFound[i], (i == numericsCount -1) ? "" : ", ");
-    }
+    printCategory(output, ctx, CATEGORY_NUMERIC);
     fprintf(output, "]\n\n");
 
     // String literals
     fprintf(output, "String Literals: [");
-    for (int i = 0; i < stringLiteralsCount; i++) {
-        fprintf(output, "%s%s", stringLiteralsFound[i], (i == stringLiteralsCount -1) ? "" : ", ");
-    }
+    printCategory(output, ctx, CATEGORY_STRING_LITERAL);
     fprintf(output, "]\n\n");
 
     // Multi-char operators
     fprintf(output, "Multi-char Operators: [");
-    for (int i = 0; i < multiCharOpsCount; i++) {
-        fprintf(output, "%s%s", multiCharOpsFound[i], (i == multiCharOpsCount -1) ? "" : ", ");
-    }
+    printCategory(output, ctx, CATEGORY_MULTI_CHAR_OPERATOR);
     fprintf(output, "]\n\n");
 
     // Single char operators
     fprintf(output, "Operators: [");
-    for (int i = 0; i < operatorsCount; i++) {
-        fprintf(output, "%s%s", operatorsFound[i], (i == operatorsCount -1) ? "" : ", ");
-    }
+    printCategory(output, ctx, CATEGORY_OPERATOR);
     fprintf(output, "]\n\n");
 
     // Separators
     fprintf(output, "Separators: [");
-    for (int i = 0; i < separatorsCount; i++) {
-        fprintf(output, "%s%s", separatorsFound[i], (i == separatorsCount -1) ? "" : ", ");
-    }
+    printCategory(output, ctx, CATEGORY_SEPARATOR);
     fprintf(output, "]\n\n");
 
     // Brackets
     fprintf(output, "Brackets: [");
-    for (int i = 0; i < bracketsCount; i++) {
-        fprintf(output, "%s%s", bracketsFound[i], (i == bracketsCount -1) ? "" : ", ");
-    }
+    printCategory(output, ctx, CATEGORY_BRACKET);
     fprintf(output, "]\n\n");
 
     // Special Symbols
     fprintf(output, "Special Symbols: [");
-    for (int i = 0; i < specialSymbolsCount; i++) {
-        fprintf(output, "%s%s", specialSymbolsFound[i], (i == specialSymbolsCount -1) ? "" : ", ");
-    }
+    printCategory(output, ctx, CATEGORY_SPECIAL_SYMBOL);
     fprintf(output, "]\n\n");
 
     // Other tokens
     fprintf(output, "Others: [");
-    for (int i = 0; i < othersCount; i++) {
-        fprintf(output, "%s%s", othersFound[i], (i == othersCount -1) ? "" : ", ");
-    }
+    printCategory(output, ctx, CATEGORY_OTHER);
     fprintf(output, "]\n\n");
 
     // Print Symbol Table
@@ -674,9 +1604,10 @@ void processFile(FILE *input, FILE *output) {
     fprintf(output, "---------------------------------------------------------------\n");
     fprintf(output, "| Name            | DataType               | Value          | Line |\n");
     fprintf(output, "---------------------------------------------------------------\n");
-    for (int i = 0; i < symbolCount; i++) {
+    for (int i = 0; i < ctx->symbolCount; i++) {
+        const Symbol *symbol = &ctx->symbolTable[i];
         fprintf(output, "| %-15s | %-21s | %-14s | %-4d |\n",
-                symbolTable[i].name, symbolTable[i].type, symbolTable[i].value, symbolTable[i].line);
+                symbol->name, symbol->type, symbol->value, symbol->line);
     }
     fprintf(output, "---------------------------------------------------------------\n");
 
@@ -685,8 +1616,705 @@ void processFile(FILE *input, FILE *output) {
     fprintf(output, "***************************************************\n");
 }
 
+// The report as one JSON object on a single line; input names the source
+// (NULL leaves the field out)
+void writeReportJson(const LexerContext *ctx, const char *input, FILE *output) {
+    fprintf(output, "{");
+    if (input) {
+        fprintf(output, "\"input\":");
+        writeJsonString(input, output);
+        fprintf(output, ",");
+    }
+    fprintf(output, "\"categories\":{");
+    for (int c = 0; c < CATEGORY_COUNT; c++) {
+        const IdList *list = &ctx->categories[c];
+        fprintf(output, "%s\"%s\":[", c ? "," : "", categoryKeys[c]);
+        for (int i = 0; i < list->count; i++) {
+            if (i) fputc(',', output);
+            writeJsonString(tokenListGet(&ctx->interned, list->ids[i]), output);
+        }
+        fprintf(output, "]");
+    }
+    fprintf(output, "},\"symbols\":[");
+    for (int i = 0; i < ctx->symbolCount; i++) {
+        const Symbol *symbol = &ctx->symbolTable[i];
+        fprintf(output, "%s{\"name\":", i ? "," : "");
+        writeJsonString(symbol->name, output);
+        fprintf(output, ",\"type\":");
+        writeJsonString(symbol->type, output);
+        fprintf(output, ",\"value\":");
+        writeJsonString(symbol->value, output);
+        fprintf(output, ",\"line\":%d}", symbol->line);
+    }
+    fprintf(output, "]}\n");
+}
+
+int processFile(LexerContext *ctx, FILE *input, FILE *output) {
+    int status = analyzeFile(ctx, input);
+    writeReport(ctx, output);
+    return status;
+}
+
+// ==================== Pipelined Analysis ====================
+// Three stages connected by bounded single-producer/single-consumer queues:
+//   reader thread  -> fills input blocks from disk
+//   calling thread -> lexes blocks into one of two contexts
+//   writer thread  -> writes the finished context's report
+// so the next file is read and lexed while the previous report is written.
+
+#define PIPELINE_BLOCK_SIZE (1024 * 1024)
+#define PIPELINE_BLOCKS 4        // Input blocks in flight
+#define PIPELINE_CONTEXTS 2      // One being lexed, one being written
+#define QUEUE_CAPACITY 8         // Power of two, >= every pool size
+#define QUEUE_SPINS 64           // Polls of a full or empty queue before the thread blocks
+
+// Pushes and pops are lock-free while the queue has room and items. A thread
+// that has to wait polls briefly, then sleeps on the condition variable; the
+// other side only takes the lock to wake it when someone is waiting.
+typedef struct {
+    void *slots[QUEUE_CAPACITY];
+    atomic_size_t head;  // Next slot to pop (consumer side)
+    atomic_size_t tail;  // Next slot to push (producer side)
+    atomic_int waiting;  // Threads blocked (or about to block) on changed
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} SpscQueue;
+
+static void queueInit(SpscQueue *q) {
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->waiting, 0);
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->changed, NULL);
+}
+
+static void queueDestroy(SpscQueue *q) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->changed);
+}
+
+static bool queueFull(SpscQueue *q, size_t tail) {
+    return tail - atomic_load_explicit(&q->head, memory_order_acquire) == QUEUE_CAPACITY;
+}
+
+static bool queueEmpty(SpscQueue *q, size_t head) {
+    return atomic_load_explicit(&q->tail, memory_order_acquire) == head;
+}
+
+// Registers as a waiter before the last check, so a push or pop that misses
+// the registration has already happened and the check sees it
+static void queueBlock(SpscQueue *q, bool (*stillWaiting)(SpscQueue *, size_t), size_t index) {
+    pthread_mutex_lock(&q->lock);
+    atomic_fetch_add(&q->waiting, 1);
+    atomic_thread_fence(memory_order_seq_cst);  // Pairs with the fence in queueWake
+    while (stillWaiting(q, index)) pthread_cond_wait(&q->changed, &q->lock);
+    atomic_fetch_sub(&q->waiting, 1);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void queueWake(SpscQueue *q) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&q->waiting, memory_order_relaxed) == 0) return;
+    pthread_mutex_lock(&q->lock);
+    pthread_cond_signal(&q->changed);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void queuePush(SpscQueue *q, void *item) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    for (int spin = 0; queueFull(q, tail); spin++) {
+        if (spin < QUEUE_SPINS) {
+            sched_yield();
+        } else {
+            queueBlock(q, queueFull, tail);
+        }
+    }
+    q->slots[tail % QUEUE_CAPACITY] = item;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    queueWake(q);
+}
+
+static void *queuePop(SpscQueue *q) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    for (int spin = 0; queueEmpty(q, head); spin++) {
+        if (spin < QUEUE_SPINS) {
+            sched_yield();
+        } else {
+            queueBlock(q, queueEmpty, head);
+        }
+    }
+    void *item = q->slots[head % QUEUE_CAPACITY];
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    queueWake(q);
+    return item;
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+    bool last;          // Final block of the current file
+    const char *error;  // Set when the file could not be opened or read
+} InputBlock;
+
+typedef struct {
+    LexerContext *ctx;
+    const char *path;
+} ReportJob;
+
+typedef struct {
+    const char *const *paths;
+    int count;
+    FILE *output;
+    ReportFormat format;
+    bool labelReports;       // Name each report when there are several inputs
+    SpscQueue filledBlocks;  // reader -> lexer
+    SpscQueue freeBlocks;    // lexer -> reader
+    SpscQueue readyReports;  // lexer -> writer, NULL ends the run
+    SpscQueue freeReports;   // writer -> lexer
+} Pipeline;
+
+static void *pipelineReader(void *arg) {
+    Pipeline *pipe = arg;
+    for (int f = 0; f < pipe->count; f++) {
+        bool useStdin = strcmp(pipe->paths[f], "-") == 0;
+        FILE *input = useStdin ? stdin : fopen(pipe->paths[f], "rb");
+        InputSource src;
+        bool opened = input && openInputSource(&src, input);
+        bool last = false;
+        while (!last) {
+            InputBlock *block = queuePop(&pipe->freeBlocks);
+            // Decompresses straight into the block the lexer will read
+            block->len = opened ? readInputSource(&src, block->data, PIPELINE_BLOCK_SIZE) : 0;
+            block->error = !input ? "could not open file" : src.error;
+            block->last = last = block->error || block->len < PIPELINE_BLOCK_SIZE;
+            queuePush(&pipe->filledBlocks, block);
+        }
+        if (input) {
+            closeInputSource(&src);
+            if (!useStdin) fclose(input);
+        }
+    }
+    return NULL;
+}
+
+static void *pipelineWriter(void *arg) {
+    Pipeline *pipe = arg;
+    ReportJob *job;
+    while ((job = queuePop(&pipe->readyReports)) != NULL) {
+        if (pipe->format == REPORT_JSON) {
+            writeReportJson(job->ctx, job->path, pipe->output);
+        } else {
+            if (pipe->labelReports) fprintf(pipe->output, "Input: %s\n", job->path);
+            writeReport(job->ctx, pipe->output);
+        }
+        queuePush(&pipe->freeReports, job);
+    }
+    return NULL;
+}
+
+// Analyzes each path in order ("-" is stdin) and writes one report per input to output.
+// invalidIdentifiers receives the total count of invalid identifiers found.
+// The statistics of each input are collected apart and merged into stats only
+// when the whole input was read, so a failed input leaves no partial counts.
+// errors[i] receives NULL or why paths[i] failed; nothing is printed.
+// Returns 0 on success, 1 if an input failed or the output could not be written.
+int analyzeFilesPipelined(const char *const *paths, int count, FILE *output, ReportFormat format,
+                          TokenStats *stats, int *invalidIdentifiers, const char **errors) {
+    Pipeline pipe;
+    memset(&pipe, 0, sizeof(pipe));
+    pipe.paths = paths;
+    pipe.count = count;
+    pipe.output = output;
+    pipe.format = format;
+    pipe.labelReports = count > 1;
+    queueInit(&pipe.filledBlocks);
+    queueInit(&pipe.freeBlocks);
+    queueInit(&pipe.readyReports);
+    queueInit(&pipe.freeReports);
+    *invalidIdentifiers = 0;
+    for (int f = 0; f < count; f++) errors[f] = NULL;
+
+    InputBlock blocks[PIPELINE_BLOCKS];
+    ReportJob jobs[PIPELINE_CONTEXTS];
+    int status = 0;
+    memset(blocks, 0, sizeof(blocks));
+    memset(jobs, 0, sizeof(jobs));
+    TokenStats *inputStats = stats ? createTokenStats() : NULL;  // Only touched by this thread
+    if (stats && !inputStats) status = 1;
+    for (int b = 0; b < PIPELINE_BLOCKS; b++) {
+        blocks[b].data = malloc(PIPELINE_BLOCK_SIZE);
+        if (!blocks[b].data) status = 1;
+        queuePush(&pipe.freeBlocks, &blocks[b]);
+    }
+    for (int j = 0; j < PIPELINE_CONTEXTS; j++) {
+        jobs[j].ctx = createLexerContext();
+        if (!jobs[j].ctx) status = 1;
+        else attachTokenStats(jobs[j].ctx, inputStats);
+        queuePush(&pipe.freeReports, &jobs[j]);
+    }
+
+    pthread_t reader, writer;
+    bool readerStarted = false, writerStarted = false;
+    if (status == 0) readerStarted = pthread_create(&reader, NULL, pipelineReader, &pipe) == 0;
+    if (readerStarted) writerStarted = pthread_create(&writer, NULL, pipelineWriter, &pipe) == 0;
+
+    if (!readerStarted || !writerStarted) {
+        const char *error = status ? LEXER_OUT_OF_MEMORY : "could not start the analysis pipeline";
+        for (int f = 0; f < count; f++) errors[f] = error;
+        status = 1;
+        // Let a reader that did start run to completion so it can be joined
+        if (readerStarted) {
+            for (int f = 0; f < count; f++) {
+                bool last;
+                do {
+                    InputBlock *block = queuePop(&pipe.filledBlocks);
+                    last = block->last;
+                    queuePush(&pipe.freeBlocks, block);
+                } while (!last);
+            }
+        }
+    } else {
+        ReportJob *spare = NULL;  // Job of a failed input, reused without a round trip
+        for (int f = 0; f < count; f++) {
+            ReportJob *job = spare ? spare : queuePop(&pipe.freeReports);
+            spare = NULL;
+            resetLexerContext(job->ctx);
+            if (inputStats) resetTokenStats(inputStats);
+            job->path = paths[f];
+
+            const char *error = NULL;
+            bool last;
+            do {
+                InputBlock *block = queuePop(&pipe.filledBlocks);
+                if (!error) error = block->error;
+                if (!error && feedLexer(job->ctx, block->data, block->len) != 0) error = getLexerError(job->ctx);
+                last = block->last;  // The reader may refill the block once it is pushed back
+                queuePush(&pipe.freeBlocks, block);
+            } while (!last);
+            if (!error && finishLexer(job->ctx) != 0) error = getLexerError(job->ctx);
+
+            if (error) {
+                errors[f] = error;
+                status = 1;
+                spare = job;  // Only the writer pushes to freeReports
+                continue;
+            }
+            *invalidIdentifiers += getCategoryCount(job->ctx, CATEGORY_INVALID_IDENTIFIER);
+            if (inputStats) mergeTokenStats(stats, inputStats);
+            queuePush(&pipe.readyReports, job);
+        }
+        queuePush(&pipe.readyReports, NULL);
+        pthread_join(writer, NULL);
+        if (ferror(output)) status = 1;
+    }
+    if (readerStarted) pthread_join(reader, NULL);
+
+    for (int b = 0; b < PIPELINE_BLOCKS; b++) free(blocks[b].data);
+    for (int j = 0; j < PIPELINE_CONTEXTS; j++) destroyLexerContext(jobs[j].ctx);
+    destroyTokenStats(inputStats);
+    queueDestroy(&pipe.filledBlocks);
+    queueDestroy(&pipe.freeBlocks);
+    queueDestroy(&pipe.readyReports);
+    queueDestroy(&pipe.freeReports);
+    return status;
+}
+
+
+// ==================== Token Diff ====================
+// Compares two analyzed inputs token by token. Tokens are compared by their
+// 64-bit text hash, so both contexts can keep their own intern IDs. The diff
+// runs in two passes: first on source lines (hash of each line's tokens), then
+// on the tokens of the lines that changed, so an edit deep inside a large
+// file costs time proportional to its size, not to the file's.
+// Both passes use Myers' O((N+M)D) algorithm in its linear-space form, which
+// splits the problem at the middle snake instead of storing every D-path.
+
+#define DIFF_MAX_COST 256  // Edit distance searched per split before settling for a near-minimal split
+
+typedef struct {
+    const unsigned long long *a;
+    const unsigned long long *b;
+    bool *removed;  // Per element of a
+    bool *added;    // Per element of b
+    long *forward;  // Furthest x per diagonal, indexed by k + offset
+    long *backward; // Same, searching from the end
+    long offset;
+} DiffState;
+
+// Finds the middle snake of a[aLo, aHi) against b[bLo, bHi), both non-empty.
+// The split point (*x, *y) divides the edit script into two halves; the
+// snake's end (*u, *v) starts the second half. Coordinates are relative.
+static void findMiddleSnake(const DiffState *d, long aLo, long aHi, long bLo, long bHi, long *x, long *y, long *u, long *v) {
+    long n = aHi - aLo, m = bHi - bLo;
+    long delta = n - m;
+    bool odd = delta & 1;
+    long maxD = (n + m + 1) / 2;
+    long *vf = d->forward + d->offset, *vb = d->backward + d->offset;
+    vf[1] = 0;
+    vb[1] = 0;
+
+    for (long D = 0; D <= maxD; D++) {
+        if (D > DIFF_MAX_COST) {
+            // Too expensive: split at the forward path that got furthest
+            long best = -1;
+            for (long k = -D + 1; k <= D - 1; k += 2) {
+                long fx = vf[k] < n ? vf[k] : n;
+                long fy = fx - k < m ? fx - k : m;
+                if (fy >= 0 && fx + fy > best) {
+                    best = fx + fy;
+                    *x = *u = fx;
+                    *y = *v = fy;
+                }
+            }
+            return;
+        }
+        for (long k = -D; k <= D; k += 2) {
+            long px = (k == -D || (k != D && vf[k - 1] < vf[k + 1])) ? vf[k + 1] : vf[k - 1] + 1;
+            long py = px - k, sx = px;
+            while (px < n && py < m && d->a[aLo + px] == d->b[bLo + py]) px++, py++;
+            vf[k] = px;
+            if (odd && k >= delta - (D - 1) && k <= delta + (D - 1) && vf[k] + vb[delta - k] >= n) {
+                *x = sx;
+                *y = sx - k;
+                *u = px;
+                *v = py;
+                return;
+            }
+        }
+        for (long k = -D; k <= D; k += 2) {
+            long px = (k == -D || (k != D && vb[k - 1] < vb[k + 1])) ? vb[k + 1] : vb[k - 1] + 1;
+            long py = px - k, sx = px;
+            while (px < n && py < m && d->a[aHi - 1 - px] == d->b[bHi - 1 - py]) px++, py++;
+            vb[k] = px;
+            if (!odd && delta - k >= -D && delta - k <= D && vb[k] + vf[delta - k] >= n) {
+                *x = n - px;
+                *y = m - py;
+                *u = n - sx;
+                *v = m - (sx - k);
+                return;
+            }
+        }
+    }
+    // Not reached: the paths always meet by D = maxD
+    *x = *u = n;
+    *y = *v = 0;
+}
+
+static void diffRange(DiffState *d, long aLo, long aHi, long bLo, long bHi) {
+    while (aLo < aHi && bLo < bHi && d->a[aLo] == d->b[bLo]) aLo++, bLo++;
+    while (aLo < aHi && bLo < bHi && d->a[aHi - 1] == d->b[bHi - 1]) aHi--, bHi--;
+    if (aLo == aHi || bLo == bHi) {
+        for (long i = aLo; i < aHi; i++) d->removed[i] = true;
+        for (long j = bLo; j < bHi; j++) d->added[j] = true;
+        return;
+    }
+    long x = 0, y = 0, u = 0, v = 0;
+    findMiddleSnake(d, aLo, aHi, bLo, bHi, &x, &y, &u, &v);
+    if ((x == 0 && y == 0 && u == 0 && v == 0) || (x == aHi - aLo && y == bHi - bLo)) {
+        // A split that makes no progress (only after giving up on the cost)
+        for (long i = aLo; i < aHi; i++) d->removed[i] = true;
+        for (long j = bLo; j < bHi; j++) d->added[j] = true;
+        return;
+    }
+    diffRange(d, aLo, aLo + x, bLo, bLo + y);
+    diffRange(d, aLo + u, aHi, bLo + v, bHi);
+}
+
+// Marks the elements of a missing from b as removed and those of b missing
+// from a as added, with a minimal (or, past DIFF_MAX_COST, near-minimal) script.
+// Returns false when memory runs out.
+static bool diffSequences(const unsigned long long *a, long n, const unsigned long long *b, long m, bool *removed, bool *added) {
+    DiffState d;
+    d.a = a;
+    d.b = b;
+    d.removed = removed;
+    d.added = added;
+    long diagonals = (n + m + 1) / 2;
+    if (diagonals > DIFF_MAX_COST + 1) diagonals = DIFF_MAX_COST + 1;
+    d.offset = diagonals + 1;
+    d.forward = malloc((2 * d.offset + 1) * sizeof(long));
+    d.backward = malloc((2 * d.offset + 1) * sizeof(long));
+    bool ok = d.forward && d.backward;
+    if (ok) diffRange(&d, 0, n, 0, m);
+    free(d.forward);
+    free(d.backward);
+    return ok;
+}
+
+// One side of a diff: token hashes, the line of every token and the
+// hash of every line that holds tokens
+typedef struct {
+    const LexerContext *ctx;
+    size_t count;
+    unsigned long long *hashes;
+    int *lines;
+    long lineCount;
+    unsigned long long *lineHashes;
+    size_t *lineFirstToken;  // lineCount + 1 entries
+    bool *removed;           // Per token, set by the diff
+} DiffSide;
+
+static bool prepareDiffSide(DiffSide *side, const LexerContext *ctx) {
+    memset(side, 0, sizeof(*side));
+    side->ctx = ctx;
+    side->count = ctx->tokens.count;
+    size_t n = side->count ? side->count : 1;
+    side->hashes = malloc(n * sizeof(unsigned long long));
+    side->lines = malloc(n * sizeof(int));
+    side->lineHashes = malloc(n * sizeof(unsigned long long));
+    side->lineFirstToken = malloc((n + 1) * sizeof(size_t));
+    side->removed = calloc(n, sizeof(bool));
+    if (!side->hashes || !side->lines || !side->lineHashes || !side->lineFirstToken || !side->removed) return false;
+
+    // Token offsets only grow, so the line index is walked once
+    size_t line = 0;
+    for (size_t t = 0; t < side->count; t++) {
+        size_t offset = ctx->tokens.offsets[t];
+        while (line + 1 < ctx->lineStartCount && ctx->lineStarts[line + 1] <= offset) line++;
+        side->hashes[t] = ctx->idHashes[ctx->tokens.ids[t]];
+        side->lines[t] = (int)line + 1;
+        if (t == 0 || side->lines[t] != side->lines[t - 1]) {
+            side->lineFirstToken[side->lineCount] = t;
+            side->lineHashes[side->lineCount++] = 14695981039346656037ULL;
+        }
+        unsigned long long *h = &side->lineHashes[side->lineCount - 1];
+        *h = (*h ^ side->hashes[t]) * 1099511628211ULL;
+    }
+    side->lineFirstToken[side->lineCount] = side->count;
+    return true;
+}
+
+static void freeDiffSide(DiffSide *side) {
+    free(side->hashes);
+    free(side->lines);
+    free(side->lineHashes);
+    free(side->lineFirstToken);
+    free(side->removed);
+}
+
+// Line pass, then a token pass over each run of changed lines
+static bool diffTokens(DiffSide *oldSide, DiffSide *newSide) {
+    long oldLines = oldSide->lineCount, newLines = newSide->lineCount;
+    bool *lineRemoved = calloc(oldLines + 1, sizeof(bool));
+    bool *lineAdded = calloc(newLines + 1, sizeof(bool));
+    bool ok = lineRemoved && lineAdded &&
+              diffSequences(oldSide->lineHashes, oldLines, newSide->lineHashes, newLines, lineRemoved, lineAdded);
+
+    long i = 0, j = 0;
+    while (ok && (i < oldLines || j < newLines)) {
+        if (i < oldLines && j < newLines && !lineRemoved[i] && !lineAdded[j]) {
+            i++, j++;
+            continue;
+        }
+        long i0 = i, j0 = j;
+        while (i < oldLines && lineRemoved[i]) i++;
+        while (j < newLines && lineAdded[j]) j++;
+        // Tokens may only have moved between lines, so diff the run's tokens
+        size_t oldFirst = oldSide->lineFirstToken[i0], oldEnd = oldSide->lineFirstToken[i];
+        size_t newFirst = newSide->lineFirstToken[j0], newEnd = newSide->lineFirstToken[j];
+        ok = diffSequences(oldSide->hashes + oldFirst, (long)(oldEnd - oldFirst),
+                           newSide->hashes + newFirst, (long)(newEnd - newFirst),
+                           oldSide->removed + oldFirst, newSide->removed + newFirst);
+    }
+    free(lineRemoved);
+    free(lineAdded);
+    return ok;
+}
+
+// Prints tokens [first, end) one source line per output line
+static void printDiffTokens(FILE *output, const DiffSide *side, size_t first, size_t end, char mark) {
+    for (size_t t = first; t < end; t++) {
+        if (t == first || side->lines[t] != side->lines[t - 1]) {
+            if (t != first) fputc('\n', output);
+            fprintf(output, "%c %5d:", mark, side->lines[t]);
+        }
+        fprintf(output, " %s", tokenListGet(&side->ctx->interned, side->ctx->tokens.ids[t]));
+    }
+    if (end > first) fputc('\n', output);
+}
+
+// Maps every intern ID of from to the ID of the same text in to, or -1.
+// Computed once so the symbol and category passes need no more hashing.
+static int *mapInternIds(const LexerContext *from, const LexerContext *to) {
+    int *map = malloc((from->interned.count + 1) * sizeof(int));
+    if (!map) return NULL;
+    for (int id = 0; id < from->interned.count; id++)
+        map[id] = tokenListFind(&to->interned, tokenListGet(&from->interned, id));
+    return map;
+}
+
+// Symbol table index of every intern ID, or -1
+static int *symbolIndexes(const LexerContext *ctx) {
+    int *indexes = malloc((ctx->interned.count + 1) * sizeof(int));
+    if (!indexes) return NULL;
+    for (int id = 0; id < ctx->interned.count; id++) indexes[id] = -1;
+    for (int i = 0; i < ctx->symbolCount; i++) {
+        int id = tokenListFind(&ctx->interned, ctx->symbolTable[i].name);
+        if (id >= 0) indexes[id] = i;
+    }
+    return indexes;
+}
+
+// The symbol of the other context with the same name as symbol s, or NULL
+static const Symbol *matchingSymbol(const LexerContext *ctx, int s, const int *idMap,
+                             const LexerContext *other, const int *otherSymbols) {
+    int id = tokenListFind(&ctx->interned, ctx->symbolTable[s].name);
+    int otherId = id >= 0 ? idMap[id] : -1;
+    if (otherId < 0 || otherSymbols[otherId] < 0) return NULL;
+    return &other->symbolTable[otherSymbols[otherId]];
+}
+
+// Category membership of every intern ID, one bit per category
+static unsigned short *categoryMasks(const LexerContext *ctx) {
+    unsigned short *masks = calloc(ctx->interned.count + 1, sizeof(unsigned short));
+    if (!masks) return NULL;
+    for (int c = 0; c < CATEGORY_COUNT; c++)
+        for (int i = 0; i < ctx->categories[c].count; i++) masks[ctx->categories[c].ids[i]] |= 1u << c;
+    return masks;
+}
+
+// Counts the entries of category c in from that are not in c in the other
+// context, writing them to output unless it is NULL
+static int missingEntries(FILE *output, const LexerContext *from, const int *idMap, const unsigned short *otherMasks, int c) {
+    int missing = 0;
+    const IdList *list = &from->categories[c];
+    for (int i = 0; i < list->count; i++) {
+        int id = idMap[list->ids[i]];
+        if (id >= 0 && (otherMasks[id] & (1u << c))) continue;
+        if (output) fprintf(output, "%s%s", missing ? ", " : " ", tokenListGet(&from->interned, list->ids[i]));
+        missing++;
+    }
+    return missing;
+}
+
+// Writes the differences between two analyzed inputs: token hunks, symbols
+// added, removed or changed, and category entries that appeared or vanished.
+// Both contexts must have kept their token stream. Returns 1 if the inputs
+// differ, 0 if they are token for token the same.
+int writeTokenDiff(const LexerContext *oldCtx, const char *oldName, const LexerContext *newCtx,
+                   const char *newName, FILE *output) {
+    DiffSide oldSide, newSide;
+    bool ready = prepareDiffSide(&oldSide, oldCtx);
+    ready = prepareDiffSide(&newSide, newCtx) && ready;
+    int *oldToNew = mapInternIds(oldCtx, newCtx);
+    int *newToOld = mapInternIds(newCtx, oldCtx);
+    int *oldSymbols = symbolIndexes(oldCtx);
+    int *newSymbols = symbolIndexes(newCtx);
+    unsigned short *oldMasks = categoryMasks(oldCtx);
+    unsigned short *newMasks = categoryMasks(newCtx);
+    ready = ready && oldToNew && newToOld && oldSymbols && newSymbols && oldMasks && newMasks &&
+            diffTokens(&oldSide, &newSide);
+    if (!ready) {
+        free(oldToNew);
+        free(newToOld);
+        free(oldSymbols);
+        free(newSymbols);
+        free(oldMasks);
+        free(newMasks);
+        freeDiffSide(&oldSide);
+        freeDiffSide(&newSide);
+        return -1;
+    }
+
+    fprintf(output, "=========== TOKEN DIFF ===========\n");
+    fprintf(output, "--- %s (%zu tokens)\n", oldName, oldSide.count);
+    fprintf(output, "+++ %s (%zu tokens)\n", newName, newSide.count);
+
+    size_t removedCount = 0, addedCount = 0, hunks = 0;
+    size_t i = 0, j = 0;
+    while (i < oldSide.count || j < newSide.count) {
+        if (i < oldSide.count && j < newSide.count && !oldSide.removed[i] && !newSide.removed[j]) {
+            i++, j++;
+            continue;
+        }
+        size_t i0 = i, j0 = j;
+        while ((i < oldSide.count && oldSide.removed[i]) || (j < newSide.count && newSide.removed[j])) {
+            if (i < oldSide.count && oldSide.removed[i]) i++;
+            else j++;
+        }
+        // Line of the first changed token; for an empty side, as in unified
+        // diffs, the line after which the change happened (0: at the start)
+        int oldLine = i > i0 ? oldSide.lines[i0] : (i0 ? oldSide.lines[i0 - 1] : 0);
+        int newLine = j > j0 ? newSide.lines[j0] : (j0 ? newSide.lines[j0 - 1] : 0);
+        fprintf(output, "@@ -%d,%zu +%d,%zu @@\n", oldLine, i - i0, newLine, j - j0);
+        printDiffTokens(output, &oldSide, i0, i, '-');
+        printDiffTokens(output, &newSide, j0, j, '+');
+        removedCount += i - i0;
+        addedCount += j - j0;
+        hunks++;
+    }
+    fprintf(output, "\n%zu tokens removed, %zu added in %zu hunks\n\n", removedCount, addedCount, hunks);
+
+    // Symbols are unique by name within a context
+    int symbolChanges = 0;
+    fprintf(output, "=========== SYMBOL CHANGES ===========\n");
+    for (int s = 0; s < oldCtx->symbolCount; s++) {
+        const Symbol *before = &oldCtx->symbolTable[s];
+        const Symbol *after = matchingSymbol(oldCtx, s, oldToNew, newCtx, newSymbols);
+        if (!after) {
+            fprintf(output, "- %-15s %-21s %-14s line %d\n", before->name, before->type, before->value, before->line);
+            symbolChanges++;
+        } else if (strcmp(before->type, after->type) != 0 || strcmp(before->value, after->value) != 0) {
+            fprintf(output, "~ %-15s %s %s -> %s %s (line %d -> %d)\n", before->name, before->type, before->value,
+                    after->type, after->value, before->line, after->line);
+            symbolChanges++;
+        }
+    }
+    for (int s = 0; s < newCtx->symbolCount; s++) {
+        const Symbol *after = &newCtx->symbolTable[s];
+        if (matchingSymbol(newCtx, s, newToOld, oldCtx, oldSymbols)) continue;
+        fprintf(output, "+ %-15s %-21s %-14s line %d\n", after->name, after->type, after->value, after->line);
+        symbolChanges++;
+    }
+    if (symbolChanges == 0) fprintf(output, "(none)\n");
+
+    int categoryChanges = 0;
+    fprintf(output, "\n=========== CATEGORY CHANGES ===========\n");
+    for (int c = 0; c < CATEGORY_COUNT; c++) {
+        int added = missingEntries(NULL, newCtx, newToOld, oldMasks, c);
+        int removed = missingEntries(NULL, oldCtx, oldToNew, newMasks, c);
+        if (added + removed == 0) continue;
+        fprintf(output, "%s:\n", categoryNames[c]);
+        if (added) {
+            fprintf(output, "  +");
+            missingEntries(output, newCtx, newToOld, oldMasks, c);
+            fprintf(output, "\n");
+        }
+        if (removed) {
+            fprintf(output, "  -");
+            missingEntries(output, oldCtx, oldToNew, newMasks, c);
+            fprintf(output, "\n");
+        }
+        categoryChanges += added + removed;
+    }
+    if (categoryChanges == 0) fprintf(output, "(none)\n");
+    free(oldMasks);
+    free(newMasks);
+    free(oldToNew);
+    free(newToOld);
+    free(oldSymbols);
+    free(newSymbols);
+
+    freeDiffSide(&oldSide);
+    freeDiffSide(&newSide);
+    return removedCount || addedCount || symbolChanges || categoryChanges ? 1 : 0;
+}
+
+// Everything below is the Lexical_Analyzer program; the library stops here
+#ifndef LEXER_NO_MAIN
+
+// The program gives up when memory runs out; the library reports it instead
+static void *checkedRealloc(void *ptr, size_t size) {
+    void *result = realloc(ptr, size);
+    if (!result) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    return result;
+}
+
 // Interactive validator for terminal input
-void interactiveValidator() {
+static void interactiveValidator() {
     char input[100];
     printf("\n========================================\n");
     printf("Variable Declaration Validity Check  \n");
@@ -842,36 +2470,682 @@ void interactiveValidator() {
     }
 }
 
-// ==================== Main ====================
-int main() {
-    FILE *input = fopen("input.txt", "r");
-    if (!input) {
-        printf("Error: Could not open input.txt\n");
+// ==================== Batch Validator ====================
+
+// Reason codes reported for invalid identifiers (bit flags)
+#define REASON_LENGTH        0x01  // Total length not in 8 to 14
+#define REASON_PREFIX        0x02  // Does not start with '#', '@', '!' or a lowercase letter
+#define REASON_LETTER_COUNT  0x04  // Lowercase letters count not in 4 to 7
+#define REASON_LETTER_REPEAT 0x08  // More than two consecutive same letters
+#define REASON_DIGIT_COUNT   0x10  // Digits count not in 2 to 4
+#define REASON_DIGIT_REPEAT  0x20  // More than two consecutive same digits
+#define REASON_SUFFIX        0x40  // Does not end with "@r"
+#define REASON_TRAILING      0x80  // Extra characters after "@r"
+
+static const char *reasonNames[] = {
+    "length", "prefix", "letter_count", "letter_repeat",
+    "digit_count", "digit_repeat", "suffix", "trailing"
+};
+static int reasonNameCount = sizeof(reasonNames) / sizeof(reasonNames[0]);
+
+// Same walk as isValidIdentifier_Advanced, but collects every failed rule
+// instead of stopping at the first one. Returns 0 for a valid identifier.
+static unsigned diagnoseIdentifier(const char *str) {
+    unsigned reasons = 0;
+    int i = 0, len = strlen(str);
+
+    if (len < 8 || len > 14) reasons |= REASON_LENGTH;
+
+    if (str[i] == '#' || str[i] == '@' || str[i] == '!') {
+        i++;
+    } else if (!islower(str[i])) {
+        reasons |= REASON_PREFIX;
+    }
+
+    int letterCount = 0;
+    int consec_letter = 0;
+    while (i < len && islower(str[i])) {
+        letterCount++;
+        consec_letter = (letterCount > 1 && str[i] == str[i-1]) ? consec_letter + 1 : 1;
+        if (consec_letter > 2) reasons |= REASON_LETTER_REPEAT;
+        i++;
+    }
+    if (letterCount < 4 || letterCount > 7) reasons |= REASON_LETTER_COUNT;
+
+    int digitCount = 0;
+    int consec_digit = 0;
+    while (i < len && isdigit(str[i])) {
+        digitCount++;
+        consec_digit = (digitCount > 1 && str[i] == str[i-1]) ? consec_digit + 1 : 1;
+        if (consec_digit > 2) reasons |= REASON_DIGIT_REPEAT;
+        i++;
+    }
+    if (digitCount < 2 || digitCount > 4) reasons |= REASON_DIGIT_COUNT;
+
+    if (i + 1 >= len || strncmp(&str[i], "@r", 2) != 0) {
+        reasons |= REASON_SUFFIX;
+    } else if (i + 2 != len) {
+        reasons |= REASON_TRAILING;
+    }
+    return reasons;
+}
+
+// Growable output buffer, so worker threads never touch the FILE stream
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} OutBuffer;
+
+static void outReserve(OutBuffer *b, size_t extra) {
+    if (b->len + extra <= b->cap) return;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + extra) cap *= 2;
+    b->data = checkedRealloc(b->data, cap);
+    b->cap = cap;
+}
+
+static void outWrite(OutBuffer *b, const char *s, size_t n) {
+    outReserve(b, n);
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+static void outPuts(OutBuffer *b, const char *s) {
+    outWrite(b, s, strlen(s));
+}
+
+// Escapes a name for a TSV field or a JSON string
+static void outEscaped(OutBuffer *b, const char *s, bool json) {
+    outReserve(b, strlen(s) * 6);
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        char *dst = b->data + b->len;
+        if (ch == '\\') { memcpy(dst, "\\\\", 2); b->len += 2; }
+        else if (ch == '\t') { memcpy(dst, "\\t", 2); b->len += 2; }
+        else if (ch == '\r') { memcpy(dst, "\\r", 2); b->len += 2; }
+        else if (json && ch == '"') { memcpy(dst, "\\\"", 2); b->len += 2; }
+        else if (json && ch < 0x20) { b->len += sprintf(dst, "\\u%04x", ch); }
+        else { *dst = (char)ch; b->len++; }
+    }
+}
+
+typedef enum { FORMAT_TSV, FORMAT_JSON } OutputFormat;
+
+typedef struct {
+    char *start;          // First byte of this worker's slice (whole lines only)
+    char *end;            // One past the last byte
+    OutputFormat format;
+    OutBuffer out;
+    long validCount;
+    long invalidCount;
+} BatchChunk;
+
+// One output row: the name, its verdict and the failed rules
+static void appendVerdict(OutBuffer *out, OutputFormat format, const char *name, unsigned reasons) {
+    if (format == FORMAT_JSON) {
+        outPuts(out, "{\"name\":\"");
+        outEscaped(out, name, true);
+        outPuts(out, reasons ? "\",\"valid\":false,\"reasons\":[" : "\",\"valid\":true,\"reasons\":[");
+        bool first = true;
+        for (int r = 0; r < reasonNameCount; r++) {
+            if (!(reasons & (1u << r))) continue;
+            outPuts(out, first ? "\"" : ",\"");
+            outPuts(out, reasonNames[r]);
+            outPuts(out, "\"");
+            first = false;
+        }
+        outPuts(out, "]}\n");
+    } else {
+        outEscaped(out, name, false);
+        outPuts(out, reasons ? "\tINVALID\t" : "\tVALID\t-");
+        bool first = true;
+        for (int r = 0; r < reasonNameCount; r++) {
+            if (!(reasons & (1u << r))) continue;
+            if (!first) outPuts(out, ",");
+            outPuts(out, reasonNames[r]);
+            first = false;
+        }
+        outPuts(out, "\n");
+    }
+}
+
+static void *validateChunk(void *arg) {
+    BatchChunk *chunk = arg;
+    char *p = chunk->start;
+    chunk->out.len = 0;
+    chunk->validCount = chunk->invalidCount = 0;
+
+    while (p < chunk->end) {
+        char *nl = memchr(p, '\n', chunk->end - p);
+        char *lineEnd = nl ? nl : chunk->end;
+        char *next = nl ? nl + 1 : chunk->end;
+        if (lineEnd > p && lineEnd[-1] == '\r') lineEnd--;
+        if (lineEnd == p) {
+            p = next;
+            continue;
+        }
+        *lineEnd = '\0';
+
+        unsigned reasons = isValidIdentifier_Advanced(p) ? 0 : diagnoseIdentifier(p);
+        if (reasons) chunk->invalidCount++;
+        else chunk->validCount++;
+        appendVerdict(&chunk->out, chunk->format, p, reasons);
+        p = next;
+    }
+    return NULL;
+}
+
+static int defaultThreadCount() {
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0) return n > BATCH_MAX_THREADS ? BATCH_MAX_THREADS : (int)n;
+#endif
+    return 1;
+}
+
+// Non-interactive validator: one identifier per line in, one verdict per line out.
+// Input is consumed in fixed-size blocks; each block is cut on line boundaries
+// into one slice per thread and the slices are written back in input order.
+// The verdicts are counted into validTotal and invalidTotal; the caller writes
+// the TSV header and the summary, so several inputs make one table.
+static int batchValidator(FILE *input, FILE *output, OutputFormat format, int threadCount,
+                          long *validTotal, long *invalidTotal) {
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > BATCH_MAX_THREADS) threadCount = BATCH_MAX_THREADS;
+
+    char *block = malloc(BATCH_BLOCK_SIZE + 1);
+    BatchChunk chunks[BATCH_MAX_THREADS];
+    pthread_t workers[BATCH_MAX_THREADS];
+    if (!block) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+    memset(chunks, 0, sizeof(chunks));
+
+    size_t carry = 0;
+    while (1) {
+        size_t got = fread(block + carry, 1, BATCH_BLOCK_SIZE - carry, input);
+        size_t filled = carry + got;
+        bool eof = got == 0;
+        if (filled == 0) break;
+
+        // Only hand complete lines to the workers; the tail waits for the next read
+        size_t usable = filled;
+        if (!eof) {
+            while (usable > 0 && block[usable - 1] != '\n') usable--;
+            if (usable == 0) {
+                if (filled < BATCH_BLOCK_SIZE) {
+                    carry = filled;
+                    continue;
+                }
+                // A line longer than a whole block is far too long for a name:
+                // one INVALID row for it, then skip to its newline
+                char prefix[OVERSIZED_NAME_SHOWN + 4];
+                memcpy(prefix, block, OVERSIZED_NAME_SHOWN);
+                strcpy(prefix + OVERSIZED_NAME_SHOWN, "...");
+                OutBuffer row = { NULL, 0, 0 };
+                appendVerdict(&row, format, prefix, REASON_LENGTH);
+                fwrite(row.data, 1, row.len, output);
+                free(row.data);
+                (*invalidTotal)++;
+
+                carry = 0;
+                bool lineEnded = false;
+                while (!lineEnded && (got = fread(block, 1, BATCH_BLOCK_SIZE, input)) > 0) {
+                    char *nl = memchr(block, '\n', got);
+                    if (nl) {
+                        carry = got - (nl + 1 - block);
+                        memmove(block, nl + 1, carry);
+                        lineEnded = true;
+                    }
+                }
+                if (!lineEnded) break;
+                continue;
+            }
+        }
+
+        // Split the usable range into roughly equal slices ending on newlines
+        int used = 0;
+        char *p = block;
+        char *end = block + usable;
+        for (int t = 0; t < threadCount && p < end; t++) {
+            char *sliceEnd = (t == threadCount - 1) ? end : p + (end - p) / (threadCount - t);
+            if (sliceEnd < end) {
+                char *nl = memchr(sliceEnd, '\n', end - sliceEnd);
+                sliceEnd = nl ? nl + 1 : end;
+            }
+            chunks[used].start = p;
+            chunks[used].end = sliceEnd;
+            chunks[used].format = format;
+            used++;
+            p = sliceEnd;
+        }
+        // The last line of the input may lack a newline; give it a terminator slot
+        if (usable == filled) block[usable] = '\0';
+
+        bool started[BATCH_MAX_THREADS] = { false };
+        for (int t = 1; t < used; t++) {
+            started[t] = pthread_create(&workers[t], NULL, validateChunk, &chunks[t]) == 0;
+            if (!started[t]) validateChunk(&chunks[t]);
+        }
+        validateChunk(&chunks[0]);
+        for (int t = 0; t < used; t++) {
+            if (started[t]) pthread_join(workers[t], NULL);
+            fwrite(chunks[t].out.data, 1, chunks[t].out.len, output);
+            *validTotal += chunks[t].validCount;
+            *invalidTotal += chunks[t].invalidCount;
+        }
+
+        carry = filled - usable;
+        memmove(block, block + usable, carry);
+        if (eof) break;
+    }
+
+    for (int t = 0; t < BATCH_MAX_THREADS; t++) free(chunks[t].out.data);
+    free(block);
+    return ferror(output) ? 1 : 0;
+}
+
+// ==================== Command Line ====================
+typedef enum { MODE_REPORT, MODE_BATCH, MODE_DIFF, MODE_STATS } RunMode;
+
+typedef struct {
+    RunMode mode;
+    char **inputs;            // Paths after glob expansion, "-" is stdin
+    int inputCount;
+    int inputCap;
+    const char *outputPath;   // NULL = default of the mode, "-" is stdout
+    const char *format;       // NULL = default of the mode
+    int threads;
+    bool stats;
+    bool interactive;
+} CliOptions;
+
+static void printUsage(FILE *out) {
+    fprintf(out,
+        "Usage: Lexical_Analyzer [options] [input...]\n"
+        "\n"
+        "Analyzes each input (file, glob pattern or - for stdin; default input.txt)\n"
+        "and writes one report per input. gzip/zstd inputs are decompressed on the fly.\n"
+        "\n"
+        "Options:\n"
+        "  -o, --output PATH     report destination, - for stdout (default output.txt)\n"
+        "  --format FORMAT       text or json; tsv or json with --batch\n"
+        "  --stats               append token statistics\n"
+        "  --no-interactive      skip the identifier prompt after the analysis\n"
+        "  --threads N           validation threads for --batch (default: one per CPU)\n"
+        "  -h, --help            show this help\n"
+        "  --                    end of options, the remaining arguments are inputs\n"
+        "\n"
+        "Modes:\n"
+        "  --stats-only          only the token statistics of all inputs, in fixed memory\n"
+        "  --batch               validate identifiers, one per line (default input: stdin)\n"
+        "  --diff OLD NEW        token, symbol and category changes between two inputs\n"
+        "                        (exit status 0 same, 1 different, 2 error)\n");
+}
+
+static void addInput(CliOptions *opts, const char *path) {
+    if (opts->inputCount == opts->inputCap) {
+        opts->inputCap = opts->inputCap ? opts->inputCap * 2 : 8;
+        opts->inputs = checkedRealloc(opts->inputs, opts->inputCap * sizeof(char *));
+    }
+    size_t len = strlen(path);
+    char *copy = checkedRealloc(NULL, len + 1);
+    memcpy(copy, path, len + 1);
+    opts->inputs[opts->inputCount++] = copy;
+}
+
+// Adds the files matching a pattern in sorted order. Shells normally expand
+// patterns themselves; this covers quoted patterns and shells that do not.
+// A name that matches nothing but exists as written (lit[1].txt) is taken as is.
+static bool addInputPattern(CliOptions *opts, const char *pattern) {
+#ifndef _WIN32
+    if (strpbrk(pattern, "*?[")) {
+        glob_t matches;
+        int result = glob(pattern, 0, NULL, &matches);
+        if (result != 0) {
+            if (result != GLOB_NOMATCH) globfree(&matches);
+            if (access(pattern, F_OK) == 0) {
+                addInput(opts, pattern);
+                return true;
+            }
+            fprintf(stderr, "Error: No input matches %s\n", pattern);
+            return false;
+        }
+        for (size_t i = 0; i < matches.gl_pathc; i++) addInput(opts, matches.gl_pathv[i]);
+        globfree(&matches);
+        return true;
+    }
+#endif
+    addInput(opts, pattern);
+    return true;
+}
+
+static void freeCliOptions(CliOptions *opts) {
+    for (int i = 0; i < opts->inputCount; i++) free(opts->inputs[i]);
+    free(opts->inputs);
+}
+
+static bool optionTakesValue(const char *arg) {
+    const char *options[] = { "-o", "--output", "--format", "--threads" };
+    for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++)
+        if (strcmp(arg, options[i]) == 0) return true;
+    return false;
+}
+
+// Selects the run mode; modes exclude each other, so a second, different one is an error
+static bool selectMode(CliOptions *opts, RunMode mode, const char *option, const char **modeOption) {
+    if (*modeOption && opts->mode != mode) {
+        fprintf(stderr, "Error: %s cannot be combined with %s\n", option, *modeOption);
+        printUsage(stderr);
+        return false;
+    }
+    opts->mode = mode;
+    *modeOption = option;
+    return true;
+}
+
+// Returns 0 when the options are usable, 1 on an error and -1 after --help
+static int parseCommandLine(int argc, char *argv[], CliOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->mode = MODE_REPORT;
+    opts->threads = defaultThreadCount();
+    opts->interactive = true;
+
+    const char *modeOption = NULL;  // Option that selected the mode
+    bool optionsEnded = false;
+    for (int a = 1; a < argc; a++) {
+        const char *arg = argv[a];
+        bool hasValue = a + 1 < argc;
+        if (optionsEnded) {
+            if (!addInputPattern(opts, arg)) return 1;
+        } else if (strcmp(arg, "--") == 0) {
+            optionsEnded = true;
+        } else if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            printUsage(stdout);
+            return -1;
+        } else if (strcmp(arg, "--batch") == 0) {
+            if (!selectMode(opts, MODE_BATCH, arg, &modeOption)) return 1;
+        } else if (strcmp(arg, "--diff") == 0) {
+            if (!selectMode(opts, MODE_DIFF, arg, &modeOption)) return 1;
+        } else if (strcmp(arg, "--stats") == 0) {
+            opts->stats = true;
+        } else if (strcmp(arg, "--stats-only") == 0) {
+            if (!selectMode(opts, MODE_STATS, arg, &modeOption)) return 1;
+        } else if (strcmp(arg, "--no-interactive") == 0) {
+            opts->interactive = false;
+        } else if (strcmp(arg, "-") == 0 || arg[0] != '-') {
+            if (!addInputPattern(opts, arg)) return 1;
+        } else if (!hasValue && optionTakesValue(arg)) {
+            fprintf(stderr, "Error: Missing value for %s\n", arg);
+            return 1;
+        } else if (strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) {
+            opts->outputPath = argv[++a];
+        } else if (strcmp(arg, "--format") == 0) {
+            opts->format = argv[++a];
+        } else if (strcmp(arg, "--threads") == 0) {
+            const char *value = argv[++a];
+            char *end;
+            long threads = strtol(value, &end, 10);
+            if (end == value || *end != '\0' || threads < 1 || threads > INT_MAX) {
+                fprintf(stderr, "Error: --threads needs a positive number, not '%s'\n", value);
+                return 1;
+            }
+            opts->threads = (int)threads;
+        } else {
+            fprintf(stderr, "Error: Unknown option %s\n", arg);
+            printUsage(stderr);
+            return 1;
+        }
+    }
+    // --stats-only already implies --stats; batch and diff have no statistics
+    if (opts->stats && (opts->mode == MODE_BATCH || opts->mode == MODE_DIFF)) {
+        fprintf(stderr, "Error: --stats cannot be combined with %s\n", modeOption);
+        printUsage(stderr);
         return 1;
     }
+    return 0;
+}
 
-    FILE *output = fopen("output.txt", "w");
+// Default mode: one report per input, then the optional identifier prompt
+static int runReports(const CliOptions *opts) {
+    const char *defaultInput = "input.txt";
+    const char *const *inputs = opts->inputCount ? (const char *const *)opts->inputs : &defaultInput;
+    int inputCount = opts->inputCount ? opts->inputCount : 1;
+
+    ReportFormat format = REPORT_TEXT;
+    if (opts->format && strcmp(opts->format, "json") == 0) format = REPORT_JSON;
+    else if (opts->format && strcmp(opts->format, "text") != 0) {
+        fprintf(stderr, "Error: Unknown format '%s' (expected text or json)\n", opts->format);
+        return 1;
+    }
+
+    const char *outputPath = opts->outputPath ? opts->outputPath : "output.txt";
+    bool toStdout = strcmp(outputPath, "-") == 0;
+    FILE *output = toStdout ? stdout : fopen(outputPath, "w");
     if (!output) {
-        printf("Error: Could not open output.txt\n");
-        fclose(input);
+        fprintf(stderr, "Error: Could not open %s\n", outputPath);
         return 1;
     }
 
-    processFile(input, output);
+    TokenStats *stats = opts->stats ? createTokenStats() : NULL;
+    const char **errors = checkedRealloc(NULL, inputCount * sizeof(char *));
+    int invalidIdentifiersCount = 0;
+    int status = analyzeFilesPipelined(inputs, inputCount, output, format, stats, &invalidIdentifiersCount, errors);
+    bool inputFailed = false;
+    for (int i = 0; i < inputCount; i++) {
+        if (!errors[i]) continue;
+        fprintf(stderr, "Error: Could not read %s (%s)\n", inputs[i], errors[i]);
+        inputFailed = true;
+    }
+    if (status != 0 && !inputFailed) fprintf(stderr, "Error: Could not write %s\n", outputPath);
+    free(errors);
+    if (status == 0 && stats) {
+        if (format == REPORT_JSON) writeTokenStatsJson(stats, output);
+        else writeTokenStats(stats, output);
+    }
+    destroyTokenStats(stats);
+    if (toStdout) fflush(stdout);
+    else fclose(output);
+    if (status != 0) return 1;
 
-    fclose(input);
-    fclose(output);
+    // With the report on stdout the messages go to stderr
+    FILE *messages = toStdout ? stderr : stdout;
+    bool readsStdin = false;
+    for (int i = 0; i < inputCount; i++) readsStdin |= strcmp(inputs[i], "-") == 0;
 
     if (invalidIdentifiersCount > 0) {
-        printf("Invalid identifiers found in input.txt. Please remove or correct them to make the code valid.\n");
+        const char *where = inputCount > 1 ? "the inputs" : readsStdin ? "standard input" : inputs[0];
+        fprintf(messages, "Invalid identifiers found in %s. Please remove or correct them to make the code valid.\n", where);
     }
 
-    printf("\n==============================\n");
-    printf("Lexical analysis completed.\n");
-    printf("See 'output.txt' for detailed token categories and symbol table.\n");
-    printf("==============================\n");
+    fprintf(messages, "\n==============================\n");
+    fprintf(messages, "Lexical analysis completed.\n");
+    if (!toStdout) fprintf(messages, "See '%s' for detailed token categories and symbol table.\n", outputPath);
+    fprintf(messages, "==============================\n");
 
-    interactiveValidator();
+    // The prompt needs stdin and would mix into a report written to stdout
+    if (opts->interactive && !readsStdin && !toStdout) interactiveValidator();
 
     return 0;
 }
+
+// --stats-only: the inputs are lexed one after another into one set of
+// statistics, without reports, so memory does not grow with the input.
+// An input that fails is left out of the statistics entirely.
+static int runStatistics(const CliOptions *opts) {
+    const char *defaultInput = "input.txt";
+    const char *const *inputs = opts->inputCount ? (const char *const *)opts->inputs : &defaultInput;
+    int inputCount = opts->inputCount ? opts->inputCount : 1;
+
+    bool json = opts->format && strcmp(opts->format, "json") == 0;
+    if (opts->format && !json && strcmp(opts->format, "text") != 0) {
+        fprintf(stderr, "Error: Unknown format '%s' (expected text or json)\n", opts->format);
+        return 1;
+    }
+
+    const char *outputPath = opts->outputPath ? opts->outputPath : "output.txt";
+    bool toStdout = strcmp(outputPath, "-") == 0;
+    FILE *output = toStdout ? stdout : fopen(outputPath, "w");
+    if (!output) {
+        fprintf(stderr, "Error: Could not open %s\n", outputPath);
+        return 1;
+    }
+
+    LexerContext *ctx = createLexerContext();
+    TokenStats *stats = createTokenStats();
+    TokenStats *inputStats = createTokenStats();  // The current input, merged once it is read
+    if (!ctx || !stats || !inputStats) {
+        fprintf(stderr, "Error: Out of memory\n");
+        destroyLexerContext(ctx);
+        destroyTokenStats(stats);
+        destroyTokenStats(inputStats);
+        if (!toStdout) fclose(output);
+        return 1;
+    }
+    setStatisticsOnly(ctx, true);
+    attachTokenStats(ctx, inputStats);
+
+    int status = 0;
+    for (int i = 0; i < inputCount; i++) {
+        bool useStdin = strcmp(inputs[i], "-") == 0;
+        FILE *input = useStdin ? stdin : fopen(inputs[i], "rb");
+        if (!input) {
+            fprintf(stderr, "Error: Could not open %s\n", inputs[i]);
+            status = 1;
+            continue;
+        }
+        resetLexerContext(ctx);
+        resetTokenStats(inputStats);
+        if (analyzeFile(ctx, input) != 0) {
+            fprintf(stderr, "Error: Could not read %s (%s)\n", inputs[i], getLexerError(ctx));
+            status = 1;
+        } else {
+            mergeTokenStats(stats, inputStats);
+        }
+        if (!useStdin) fclose(input);
+    }
+
+    if (json) writeTokenStatsJson(stats, output);
+    else writeTokenStats(stats, output);
+    destroyTokenStats(stats);
+    destroyTokenStats(inputStats);
+    destroyLexerContext(ctx);
+    if (ferror(output)) status = 1;
+    if (toStdout) fflush(stdout);
+    else fclose(output);
+    return status;
+}
+
+static int runBatch(const CliOptions *opts) {
+    OutputFormat format = FORMAT_TSV;
+    if (opts->format && strcmp(opts->format, "json") == 0) format = FORMAT_JSON;
+    else if (opts->format && strcmp(opts->format, "tsv") != 0) {
+        fprintf(stderr, "Error: Unknown format '%s' (expected tsv or json)\n", opts->format);
+        return 1;
+    }
+
+    // Verdicts go to stdout unless an output file is named
+    bool toStdout = opts->outputPath == NULL || strcmp(opts->outputPath, "-") == 0;
+    FILE *output = toStdout ? stdout : fopen(opts->outputPath, "w");
+    if (!output) {
+        fprintf(stderr, "Error: Could not open %s\n", opts->outputPath);
+        return 1;
+    }
+
+    if (format == FORMAT_TSV) fputs("name\tverdict\treasons\n", output);
+    long validTotal = 0, invalidTotal = 0;
+    int status = 0;
+    int count = opts->inputCount ? opts->inputCount : 1;
+    for (int i = 0; i < count && status == 0; i++) {
+        const char *path = opts->inputCount ? opts->inputs[i] : "-";
+        FILE *names = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+        if (!names) {
+            fprintf(stderr, "Error: Could not open %s\n", path);
+            status = 1;
+            break;
+        }
+        status = batchValidator(names, output, format, opts->threads, &validTotal, &invalidTotal);
+        if (names != stdin) fclose(names);
+    }
+    fprintf(stderr, "Validated %ld identifiers: %ld valid, %ld invalid\n",
+            validTotal + invalidTotal, validTotal, invalidTotal);
+    if (!toStdout) fclose(output);
+    return status;
+}
+
+// Diff mode; the exit status follows diff(1): 0 same, 1 different, 2 trouble
+static int runDiff(const CliOptions *opts) {
+    if (opts->inputCount != 2) {
+        fprintf(stderr, "Error: --diff needs two inputs, the old and the new version\n");
+        return 2;
+    }
+    if (opts->format && strcmp(opts->format, "text") != 0) {
+        fprintf(stderr, "Error: Unknown format '%s' (diffs are text only)\n", opts->format);
+        return 2;
+    }
+
+    LexerContext *contexts[2] = { NULL, NULL };
+    int status = 0;
+    for (int k = 0; k < 2 && status == 0; k++) {
+        const char *path = opts->inputs[k];
+        FILE *input = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+        contexts[k] = createLexerContext();
+        if (!input || !contexts[k]) {
+            fprintf(stderr, "Error: Could not read %s\n", path);
+            status = 2;
+        } else if (analyzeFile(contexts[k], input) != 0) {
+            fprintf(stderr, "Error: Could not read %s (%s)\n", path, getLexerError(contexts[k]));
+            status = 2;
+        }
+        if (input && input != stdin) fclose(input);
+    }
+
+    if (status == 0) {
+        bool toStdout = opts->outputPath == NULL || strcmp(opts->outputPath, "-") == 0;
+        FILE *output = toStdout ? stdout : fopen(opts->outputPath, "w");
+        if (!output) {
+            fprintf(stderr, "Error: Could not open %s\n", opts->outputPath);
+            status = 2;
+        } else {
+            status = writeTokenDiff(contexts[0], opts->inputs[0], contexts[1], opts->inputs[1], output);
+            if (status < 0) {
+                fprintf(stderr, "Error: Out of memory\n");
+                status = 2;
+            }
+            if (!toStdout) fclose(output);
+        }
+    }
+    destroyLexerContext(contexts[0]);
+    destroyLexerContext(contexts[1]);
+    return status;
+}
+
+// ==================== Main ====================
+int main(int argc, char *argv[]) {
+    CliOptions opts;
+    int status = parseCommandLine(argc, argv, &opts);
+    if (status != 0) {
+        freeCliOptions(&opts);
+        return status < 0 ? 0 : status;
+    }
+
+    switch (opts.mode) {
+    case MODE_BATCH:
+        status = runBatch(&opts);
+        break;
+    case MODE_DIFF:
+        status = runDiff(&opts);
+        break;
+    case MODE_STATS:
+        status = runStatistics(&opts);
+        break;
+    default:
+        status = runReports(&opts);
+        break;
+    }
+    freeCliOptions(&opts);
+    return status;
+}
+#endif
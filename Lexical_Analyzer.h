@@ -0,0 +1,130 @@
+#ifndef LEXICAL_ANALYZER_H
+#define LEXICAL_ANALYZER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Symbol Table Struct
+typedef struct {
+    char name[100];    // Identifier name
+    char type[100];    // Data type (int, float, etc.)
+    char value[100];   // Value or "-" if uninitialized
+    int line;          // Line number declared
+} Symbol;
+
+// Token categories, in report order
+typedef enum {
+    CATEGORY_VALID_IDENTIFIER,
+    CATEGORY_INVALID_IDENTIFIER,
+    CATEGORY_KEYWORD,
+    CATEGORY_NUMERIC,
+    CATEGORY_STRING_LITERAL,
+    CATEGORY_MULTI_CHAR_OPERATOR,
+    CATEGORY_OPERATOR,
+    CATEGORY_SEPARATOR,
+    CATEGORY_BRACKET,
+    CATEGORY_SPECIAL_SYMBOL,
+    CATEGORY_OTHER,
+    CATEGORY_COUNT
+} TokenCategory;
+
+// All state of one analysis run. Contexts are independent of each other,
+// so several can be used from different threads at the same time.
+typedef struct LexerContext LexerContext;
+
+LexerContext *createLexerContext(void);
+// Forgets the previous run but keeps the allocated tables for the next one
+void resetLexerContext(LexerContext *ctx);
+void destroyLexerContext(LexerContext *ctx);
+// With reference == true lines are split by the original character-by-character
+// tokenizer instead of the table-driven one; both must yield the same tokens
+// (fuzz_tokenizer.c checks this, bench.c compares their speed)
+void setReferenceTokenizer(LexerContext *ctx, bool reference);
+
+// Analysis input: a whole stream or an in-memory buffer of source lines.
+// Streams may be gzip or zstd compressed (see README).
+// The input functions return 0, or 1 if the input could not be read or
+// memory ran out; getLexerError then describes the failure. The library
+// never exits the process. A failed run keeps failing until the context
+// is reset; its results so far stay readable.
+int analyzeFile(LexerContext *ctx, FILE *input);
+int analyzeBuffer(LexerContext *ctx, const char *data, size_t len);
+// Streaming input: chunks may split lines anywhere; finish flushes the last line
+int feedLexer(LexerContext *ctx, const char *data, size_t len);
+int finishLexer(LexerContext *ctx);
+const char *getLexerError(const LexerContext *ctx);
+
+// Results of the current run
+int getSymbolCount(const LexerContext *ctx);
+const Symbol *getSymbol(const LexerContext *ctx, int index);
+int getCategoryCount(const LexerContext *ctx, TokenCategory category);
+const char *getCategoryEntry(const LexerContext *ctx, TokenCategory category, int index);
+
+// Token locations: byte offset into the input and length of every token, in input order
+size_t getTokenCount(const LexerContext *ctx);
+size_t getTokenOffset(const LexerContext *ctx, size_t index);
+unsigned getTokenLength(const LexerContext *ctx, size_t index);
+// Category (keyword, numeric, ..., other) and intern ID of every token. Equal
+// token texts share one ID; getInternedText returns the text of an ID.
+TokenCategory getTokenCategory(const LexerContext *ctx, size_t index);
+unsigned getTokenId(const LexerContext *ctx, size_t index);
+const char *getInternedText(const LexerContext *ctx, unsigned id);
+// Occurrence count of every category in the token stream
+void countCategoryOccurrences(const LexerContext *ctx, size_t counts[CATEGORY_COUNT]);
+// Converts a byte offset into a 1-based line and byte column
+void getLineColumn(const LexerContext *ctx, size_t offset, int *line, int *column);
+
+void writeReport(const LexerContext *ctx, FILE *output);
+// Same content as one JSON object per line; input names the source (may be NULL)
+void writeReportJson(const LexerContext *ctx, const char *input, FILE *output);
+
+// Token-level differences between two analyzed inputs: changed token runs,
+// symbols added, removed or changed and category entries that appeared or
+// vanished. Returns 1 if the inputs differ, 0 if they match, -1 if memory
+// ran out (nothing is written then).
+int writeTokenDiff(const LexerContext *oldCtx, const char *oldName, const LexerContext *newCtx,
+                   const char *newName, FILE *output);
+
+typedef enum {
+    REPORT_TEXT,
+    REPORT_JSON
+} ReportFormat;
+
+// Token statistics in fixed-size sketches: occurrence counts, distinct-count
+// estimates per category and the most frequent identifiers and literals.
+// Statistics of different files or threads can be merged.
+typedef struct TokenStats TokenStats;
+
+TokenStats *createTokenStats(void);
+void resetTokenStats(TokenStats *stats);
+void destroyTokenStats(TokenStats *stats);
+// Counts every token the context lexes from now on (NULL detaches)
+void attachTokenStats(LexerContext *ctx, TokenStats *stats);
+// Statistics-only runs: tokens are counted into the attached statistics
+// without interning them, and no token stream, symbols, categories or line
+// index are kept, so memory stays fixed however large the input is. The
+// results of such a run (getTokenCount, writeReport, ...) are empty.
+void setStatisticsOnly(LexerContext *ctx, bool statisticsOnly);
+void mergeTokenStats(TokenStats *into, const TokenStats *from);
+// Estimated occurrences of any token text, keywords and punctuation included
+// (never an undercount)
+unsigned long long estimateTokenFrequency(const TokenStats *stats, const char *text);
+double estimateDistinctTokens(const TokenStats *stats, TokenCategory category);
+void writeTokenStats(const TokenStats *stats, FILE *output);
+void writeTokenStatsJson(const TokenStats *stats, FILE *output);
+// analyzeFile followed by writeReport; returns the analyzeFile status
+int processFile(LexerContext *ctx, FILE *input, FILE *output);
+
+// Reads, lexes and writes reports on separate threads, one report per path in
+// input order ("-" reads standard input). When stats is not NULL the statistics of all inputs are merged
+// into it. errors must hold count entries: errors[i] is set to NULL, or to a
+// description (static string) when paths[i] could not be read; such inputs get
+// no report and add nothing to stats. Nothing is printed.
+// Returns 0 on success, 1 if any input failed or the output could not be written.
+int analyzeFilesPipelined(const char *const *paths, int count, FILE *output, ReportFormat format,
+                          TokenStats *stats, int *invalidIdentifiers, const char **errors);
+
+bool isValidIdentifier_Advanced(const char *str);
+
+#endif
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "Lexical_Analyzer.h"
+
+// Analyzer throughput benchmark with a tracked baseline.
+//
+//   gcc -O2 -pthread -DLEXER_NO_MAIN Lexical_Analyzer.c bench.c -o bench -lm
+//   bench [input] [--repetitions N] [--baseline PATH] [--tolerance PCT] [--update-baseline]
+
+#define BENCH_REPETITIONS 5        // Samples per tokenizer, the median counts
+#define BENCH_SAMPLE_SECONDS 0.2   // Minimum length of one sample
+
+static double secondsNow(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Reads a whole file into memory; returns NULL if it cannot be read
+static char *readWholeFile(const char *path, size_t *len) {
+    FILE *input = fopen(path, "rb");
+    if (!input) return NULL;
+    char *data = NULL;
+    size_t cap = 0, got;
+    *len = 0;
+    do {
+        if (*len == cap) {
+            cap = cap ? cap * 2 : 64 * 1024;
+            char *grown = realloc(data, cap);
+            if (!grown) {
+                free(data);
+                fclose(input);
+                return NULL;
+            }
+            data = grown;
+        }
+        got = fread(data + *len, 1, cap - *len, input);
+        *len += got;
+    } while (got > 0);
+    bool failed = ferror(input);
+    fclose(input);
+    if (failed) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+// Tokens per second of one sample: repeated runs over data for at least
+// BENCH_SAMPLE_SECONDS
+static double sampleThroughput(LexerContext *ctx, const char *data, size_t len) {
+    size_t tokens = 0;
+    double start = secondsNow(), elapsed;
+    do {
+        resetLexerContext(ctx);
+        analyzeBuffer(ctx, data, len);
+        tokens += getTokenCount(ctx);
+        elapsed = secondsNow() - start;
+    } while (elapsed < BENCH_SAMPLE_SECONDS);
+    return tokens / elapsed;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, int count) {
+    qsort(values, count, sizeof(double), compareDoubles);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+// Measures the fast tokenizer against the reference tokenizer on one file.
+// Samples of the two alternate, so both see the same machine load, and the
+// median of the repetitions is reported. The gate is the fast-to-reference
+// throughput ratio, which does not depend on the machine: the run fails when
+// it falls more than tolerance percent below the baseline value. Absolute
+// tokens per second are printed for information only. With updateBaseline
+// the measurement is written to the baseline file instead.
+// Returns 0 on pass, 1 on error, 2 on a performance regression.
+static int runBenchmark(const char *path, int repetitions, const char *baselinePath, double tolerance,
+                        bool updateBaseline) {
+    size_t len;
+    char *data = readWholeFile(path, &len);
+    LexerContext *fast = data ? createLexerContext() : NULL;
+    LexerContext *reference = fast ? createLexerContext() : NULL;
+    double *samples = reference ? malloc(3 * repetitions * sizeof(double)) : NULL;
+    if (!samples) {
+        fprintf(stderr, "Error: Could not read %s\n", path);
+        destroyLexerContext(fast);
+        destroyLexerContext(reference);
+        free(data);
+        return 1;
+    }
+    setReferenceTokenizer(reference, true);
+    double *fastRates = samples, *referenceRates = samples + repetitions, *ratios = samples + 2 * repetitions;
+
+    analyzeBuffer(fast, data, len); // Warm-up, sizes the contexts' tables
+    analyzeBuffer(reference, data, len);
+    for (int r = 0; r < repetitions; r++) {
+        fastRates[r] = sampleThroughput(fast, data, len);
+        referenceRates[r] = sampleThroughput(reference, data, len);
+        ratios[r] = fastRates[r] / referenceRates[r];
+    }
+    double ratio = median(ratios, repetitions);
+    double tokensPerSecond = median(fastRates, repetitions);
+    double referencePerSecond = median(referenceRates, repetitions);
+    double bytesPerSecond = tokensPerSecond / getTokenCount(fast) * len;
+    destroyLexerContext(fast);
+    destroyLexerContext(reference);
+    free(samples);
+    free(data);
+
+    printf("file: %s\nrepetitions: %d\ntokens_per_second: %.0f\nreference_tokens_per_second: %.0f\n"
+           "megabytes_per_second: %.2f\nfast_to_reference_ratio: %.3f\n",
+           path, repetitions, tokensPerSecond, referencePerSecond, bytesPerSecond / 1e6, ratio);
+    if (!baselinePath) return 0;
+
+    if (updateBaseline) {
+        FILE *baseline = fopen(baselinePath, "w");
+        if (!baseline) {
+            fprintf(stderr, "Error: Could not write %s\n", baselinePath);
+            return 1;
+        }
+        fprintf(baseline, "fast_to_reference_ratio %.3f\ntokens_per_second %.0f\n", ratio, tokensPerSecond);
+        fclose(baseline);
+        printf("baseline: updated %s\n", baselinePath);
+        return 0;
+    }
+
+    FILE *baseline = fopen(baselinePath, "r");
+    double expected = 0, expectedTokens = 0;
+    if (!baseline || fscanf(baseline, "fast_to_reference_ratio %lf", &expected) != 1 || expected <= 0) {
+        fprintf(stderr, "Error: Could not read a fast_to_reference_ratio value from %s\n", baselinePath);
+        if (baseline) fclose(baseline);
+        return 1;
+    }
+    if (fscanf(baseline, " tokens_per_second %lf", &expectedTokens) == 1 && expectedTokens > 0) {
+        printf("baseline_tokens_per_second: %.0f (not gated, depends on the machine)\n", expectedTokens);
+    }
+    fclose(baseline);
+
+    printf("baseline_fast_to_reference_ratio: %.3f\nchange: %+.1f%%\n", expected, (ratio / expected - 1.0) * 100.0);
+    if (ratio < expected * (1.0 - tolerance / 100.0)) {
+        printf("FAIL: the fast tokenizer's lead over the reference is more than %.0f%% below the baseline\n",
+               tolerance);
+        return 2;
+    }
+    printf("PASS\n");
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = "input.txt";
+    const char *baselinePath = NULL;
+    double tolerance = 10.0;
+    int repetitions = BENCH_REPETITIONS;
+    bool updateBaseline = false;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--repetitions") == 0 && a + 1 < argc && atoi(argv[a + 1]) > 0) {
+            repetitions = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--baseline") == 0 && a + 1 < argc) {
+            baselinePath = argv[++a];
+        } else if (strcmp(argv[a], "--tolerance") == 0 && a + 1 < argc) {
+            tolerance = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--update-baseline") == 0) {
+            updateBaseline = true;
+        } else if (argv[a][0] != '-') {
+            path = argv[a];
+        } else {
+            fprintf(stderr, "Usage: bench [input] [--repetitions N] [--baseline PATH] [--tolerance PCT] [--update-baseline]\n");
+            return 1;
+        }
+    }
+    return runBenchmark(path, repetitions, baselinePath, tolerance, updateBaseline);
+}
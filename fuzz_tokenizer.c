@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "Lexical_Analyzer.h"
+
+// Differential fuzzing of the tokenizers: the same input goes through a
+// context using the table-driven tokenizer and one using the reference
+// tokenizer, and both must produce exactly the same tokens.
+//
+//   gcc -O2 -pthread -DLEXER_NO_MAIN Lexical_Analyzer.c fuzz_tokenizer.c -o fuzz_tokenizer -lm
+//   fuzz_tokenizer [iterations] [--seed S]
+//
+// libFuzzer / AFL++ build, the fuzzer provides main:
+//   clang -g -O1 -fsanitize=fuzzer,address -DLEXER_NO_MAIN -DLEXER_FUZZ Lexical_Analyzer.c fuzz_tokenizer.c -o lexer_fuzz
+
+// Compares the tokens from index first on; prints the differing line and
+// returns false if the contexts disagree
+static bool sameTokens(const LexerContext *fast, const LexerContext *reference, size_t first,
+                       const char *line) {
+    size_t count = getTokenCount(fast);
+    bool same = count == getTokenCount(reference);
+    for (size_t t = first; same && t < count; t++) {
+        same = getTokenOffset(fast, t) == getTokenOffset(reference, t) &&
+               getTokenLength(fast, t) == getTokenLength(reference, t);
+    }
+    if (!same) {
+        fprintf(stderr, "Tokenizer mismatch on line: \"%s\" (reference %zu tokens, fast %zu tokens)\n",
+                line, getTokenCount(reference) - first, count - first);
+    }
+    return same;
+}
+
+static LexerContext *createFuzzContext(bool reference) {
+    LexerContext *ctx = createLexerContext();
+    if (!ctx) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    setReferenceTokenizer(ctx, reference);
+    return ctx;
+}
+
+#ifdef LEXER_FUZZ
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static LexerContext *fast, *reference;
+    if (!fast) {
+        fast = createFuzzContext(false);
+        reference = createFuzzContext(true);
+    }
+    resetLexerContext(fast);
+    resetLexerContext(reference);
+    int fastStatus = analyzeBuffer(fast, (const char *)data, size);
+    int referenceStatus = analyzeBuffer(reference, (const char *)data, size);
+    if (fastStatus != referenceStatus || !sameTokens(fast, reference, 0, "(whole input)")) abort();
+    return 0;
+}
+#else
+// Characters the tokenizer treats specially, plus some it does not know
+static const char fuzzAlphabet[] = "+-*/%=<>!&|^~(){}[],;:#.\"' \t\r_@!abcrz AZ0123456789$?\\`\x80\xff";
+static const char *fuzzWords[] = {
+    "int ", "float ", "char ", "const ", "unsigned ", "abcd12@r", "nameab12@r", "/*", "*/", "//",
+    "++", "--", "==", "!=", "&&", "||", "+=", "\"str\"", "'c'", "3.14", "#include", ";", "(", "= 5"
+};
+
+static unsigned long long fuzzNext(unsigned long long *state) {
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+// Fills line with up to 300 random characters and words; returns its length
+static int randomLine(char *line, unsigned long long *state) {
+    int target = (int)(fuzzNext(state) % 300);
+    int len = 0;
+    int wordCount = sizeof(fuzzWords) / sizeof(fuzzWords[0]);
+    while (len < target) {
+        unsigned long long r = fuzzNext(state);
+        if (r % 4 == 0) {
+            const char *word = fuzzWords[(r >> 8) % wordCount];
+            int wordLen = strlen(word);
+            if (len + wordLen >= target) break;
+            memcpy(line + len, word, wordLen);
+            len += wordLen;
+        } else {
+            line[len++] = fuzzAlphabet[(r >> 8) % (sizeof(fuzzAlphabet) - 1)];
+        }
+    }
+    line[len] = '\0';
+    return len;
+}
+
+// Random differential test without libFuzzer. Every line is appended to one
+// growing input, so comments spanning lines are exercised as well.
+static int runFuzz(long iterations, unsigned long long seed) {
+    LexerContext *fast = createFuzzContext(false);
+    LexerContext *reference = createFuzzContext(true);
+    unsigned long long state = seed ? seed : 1;
+    char line[512];
+    int failures = 0;
+
+    for (long n = 0; n < iterations && failures < 10; n++) {
+        int len = randomLine(line, &state);
+        size_t first = getTokenCount(fast);
+        if (feedLexer(fast, line, len) != 0 || feedLexer(fast, "\n", 1) != 0 ||
+            feedLexer(reference, line, len) != 0 || feedLexer(reference, "\n", 1) != 0) {
+            fprintf(stderr, "Error: %s\n", getLexerError(fast) ? getLexerError(fast) : getLexerError(reference));
+            failures++;
+            break;
+        }
+        if (!sameTokens(fast, reference, first, line)) failures++;
+        if (n % 10000 == 9999) {
+            resetLexerContext(fast);
+            resetLexerContext(reference);
+        }
+    }
+
+    destroyLexerContext(fast);
+    destroyLexerContext(reference);
+    if (failures) {
+        fprintf(stderr, "Fuzzing found %d tokenizer mismatch(es)\n", failures);
+        return 1;
+    }
+    fprintf(stderr, "Fuzzing passed: %ld lines, reference and fast tokenizers agree\n", iterations);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    long iterations = 100000;
+    unsigned long long seed = (unsigned long long)time(NULL);
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            seed = strtoull(argv[++a], NULL, 10);
+        } else if (argv[a][0] >= '0' && argv[a][0] <= '9') {
+            iterations = atol(argv[a]);
+        } else {
+            fprintf(stderr, "Usage: fuzz_tokenizer [iterations] [--seed S]\n");
+            return 1;
+        }
+    }
+    fprintf(stderr, "Fuzzing with seed %llu\n", seed);
+    return runFuzz(iterations, seed);
+}
+#endif